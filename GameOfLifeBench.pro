@@ -0,0 +1,48 @@
+#-------------------------------------------------
+#
+# Benchmarks of the engines and file formats, see golbenchmark.h
+#
+#-------------------------------------------------
+
+QT       += core gui
+QT       += svg
+QT       -= widgets
+
+TARGET = GameOfLifeBench
+TEMPLATE = app
+
+CONFIG += console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+SOURCES += \
+    benchmain.cpp \
+    golbenchmark.cpp \
+    golfile.cpp \
+    golgrid.cpp \
+    golkernels.cpp \
+    golengine.cpp \
+    golgridengine.cpp \
+    golhashlife.cpp \
+    golsparseengine.cpp \
+    golrule.cpp \
+    golmultistateengine.cpp \
+    golthreadpool.cpp \
+    golprofiler.cpp \
+    goltrace.cpp
+
+HEADERS += \
+    golbenchmark.h \
+    golfile.h \
+    golgrid.h \
+    golkernels.h \
+    golengine.h \
+    golgridengine.h \
+    golhashlife.h \
+    golsparseengine.h \
+    golrule.h \
+    golmultistateengine.h \
+    golthreadpool.h \
+    golprofiler.h \
+    goltrace.h
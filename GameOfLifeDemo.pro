@@ -23,27 +23,60 @@ DEFINES += QT_DEPRECATED_WARNINGS
 # You can also select to disable deprecated APIs only up to a certain version of Qt.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
-QMAKE_CXXFLAGS += -fopenmp
-QMAKE_LFLAGS += -fopenmp
-
 QMAKE_LFLAGS_WINDOWS += -Wl,--stack,32000000
 
-OMP_NUM_THREADS = 4
-
 SOURCES += \
         main.cpp \
         mainwindow.cpp \
         golscene.cpp \
     golthread.cpp \
+    golrenderthread.cpp \
     renderdialog.cpp \
-    insertdialog.cpp
+    insertdialog.cpp \
+    golgrid.cpp \
+    golkernels.cpp \
+    golengine.cpp \
+    golgridengine.cpp \
+    golhashlife.cpp \
+    golsparseengine.cpp \
+    golrule.cpp \
+    golmultistateengine.cpp \
+    golframebuffer.cpp \
+    goleditqueue.cpp \
+    golthreadpool.cpp \
+    golticketmutex.cpp \
+    golperiod.cpp \
+    goldensity.cpp \
+    golfile.cpp \
+    golrunner.cpp \
+    golprofiler.cpp \
+    goltrace.cpp
 
 HEADERS += \
         mainwindow.h \
         golscene.h \
     golthread.h \
+    golrenderthread.h \
     renderdialog.h \
-    insertdialog.h
+    insertdialog.h \
+    golgrid.h \
+    golkernels.h \
+    golengine.h \
+    golgridengine.h \
+    golhashlife.h \
+    golsparseengine.h \
+    golrule.h \
+    golmultistateengine.h \
+    golframebuffer.h \
+    goleditqueue.h \
+    golthreadpool.h \
+    golticketmutex.h \
+    golperiod.h \
+    goldensity.h \
+    golfile.h \
+    golrunner.h \
+    golprofiler.h \
+    goltrace.h
 
 FORMS += \
         mainwindow.ui \
@@ -0,0 +1,52 @@
+#-------------------------------------------------
+#
+# Lockstep verification of the engines against each other, see golverifier.h
+#
+#-------------------------------------------------
+
+QT       += core gui
+QT       += svg
+QT       -= widgets
+
+TARGET = GameOfLifeVerify
+TEMPLATE = app
+
+CONFIG += console
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+SOURCES += \
+    verifymain.cpp \
+    golverifier.cpp \
+    golfile.cpp \
+    golgrid.cpp \
+    golkernels.cpp \
+    golengine.cpp \
+    golgridengine.cpp \
+    golhashlife.cpp \
+    golsparseengine.cpp \
+    golrule.cpp \
+    golmultistateengine.cpp \
+    golperiod.cpp \
+    golrunner.cpp \
+    golthreadpool.cpp \
+    golprofiler.cpp \
+    goltrace.cpp
+
+HEADERS += \
+    golverifier.h \
+    golfile.h \
+    golgrid.h \
+    golkernels.h \
+    golengine.h \
+    golgridengine.h \
+    golhashlife.h \
+    golsparseengine.h \
+    golrule.h \
+    golmultistateengine.h \
+    golperiod.h \
+    golrunner.h \
+    golthreadpool.h \
+    golprofiler.h \
+    goltrace.h
@@ -0,0 +1,11 @@
+#include "golbenchmark.h"
+
+#include <QCoreApplication>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    GOLBenchmark benchmark;
+    
+    return benchmark.run(a.arguments());
+}
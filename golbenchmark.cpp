@@ -0,0 +1,504 @@
+#include "golbenchmark.h"
+#include "golfile.h"
+#include "golthreadpool.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QTextStream>
+
+#include <algorithm>
+#include <thread>
+
+
+static const char* s_patternNames[GOLBenchmark::PatternCount] = { "soup", "sparse", "ash" };
+
+// Conway, two more Life-like ones (a replicator and a dense one) and what
+// only the multi-state engine runs, Brian's Brain and Bosco's rule
+static const char* s_rules[] = { "B3/S23", "B36/S23", "B3678/S34678", "B2/S/C3",
+                                 "R5,C0,M1,S34..58,B34..45,NM" };
+
+
+// the same random board whatever order the cells are set in
+static inline uint64_t mix(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    
+    return x ^ (x >> 31);
+}
+
+static std::vector<int> parseList(const QString& text, bool* ok)
+{
+    std::vector<int> values;
+    *ok = true;
+    
+    for (const QString& part : text.split(','))
+    {
+        bool valid;
+        int value = part.trimmed().toInt(&valid);
+        
+        if (!valid || value <= 0)
+            *ok = false;
+        else
+            values.push_back(value);
+    }
+    
+    return values;
+}
+
+
+GOLBenchmark::GOLBenchmark()
+ : m_minSeconds(BENCH_MIN_SECONDS)
+{
+}
+
+
+const char* GOLBenchmark::patternName(Pattern pattern)
+{
+    return pattern < PatternCount ? s_patternNames[pattern] : "";
+}
+
+
+int GOLBenchmark::run(const QStringList& arguments)
+{
+    if (!parse(arguments)) { return 1; }
+    
+    if (m_suites.contains("sizes"))
+        runSizes();
+    if (m_suites.contains("rules"))
+        runRules();
+    if (m_suites.contains("threads"))
+        runThreads();
+    if (m_suites.contains("files"))
+        runFiles();
+    
+    QJsonObject root;
+    root["date"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    root["hardwareThreads"] = (int)std::thread::hardware_concurrency();
+    root["minSeconds"] = m_minSeconds;
+    root["results"] = m_results;
+    
+    QByteArray json = QJsonDocument(root).toJson();
+    
+    if (m_output.isEmpty())
+    {
+        QTextStream(stdout) << json;
+        return 0;
+    }
+    
+    QFile file(m_output);
+    if (!file.open(QFile::WriteOnly) || file.write(json) != json.size())
+    {
+        QTextStream(stderr) << "Could not write " << m_output << "\n";
+        return 2;
+    }
+    
+    return 0;
+}
+
+
+bool GOLBenchmark::parse(const QStringList& arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures the engines and file formats, writes JSON.");
+    parser.addHelpOption();
+    
+    QCommandLineOption suites("suites", "Comma separated: " BENCH_SUITES ".", "list", BENCH_SUITES);
+    QCommandLineOption engines("engines", "Comma separated: grid, hashlife, infinite, multi-state.", "list");
+    QCommandLineOption sizes("sizes", "Board sides, comma separated.", "list", "64,256,1024,4096,16384,32768");
+    QCommandLineOption threads("threads", "Thread counts of the threads suite, comma separated.", "list");
+    QCommandLineOption seconds("seconds", "Minimum time per measurement.", "seconds",
+                               QString::number(BENCH_MIN_SECONDS));
+    QCommandLineOption quick("quick", "Boards up to 1024^2 and 0.1 s per measurement.");
+    QCommandLineOption output(QStringList() << "o" << "output", "JSON file instead of standard output.", "file");
+    
+    parser.addOptions(QList<QCommandLineOption>() << suites << engines << sizes << threads << seconds
+                      << quick << output);
+    
+    parser.process(arguments);
+    
+    m_output = parser.value(output);
+    
+    bool ok;
+    
+    m_suites = parser.value(suites).toLower().split(',');
+    for (const QString& suite : m_suites)
+    {
+        if (!QString(BENCH_SUITES).split(',').contains(suite))
+        {
+            QTextStream(stderr) << "Unknown suite " << suite << "\n";
+            return false;
+        }
+    }
+    
+    m_sizes = parseList(parser.value(sizes), &ok);
+    if (!ok || m_sizes.empty())
+    {
+        QTextStream(stderr) << "Invalid sizes " << parser.value(sizes) << "\n";
+        return false;
+    }
+    
+    m_minSeconds = parser.value(seconds).toDouble(&ok);
+    if (!ok || m_minSeconds <= 0.0)
+    {
+        QTextStream(stderr) << "Invalid time " << parser.value(seconds) << "\n";
+        return false;
+    }
+    
+    if (parser.isSet(quick))
+    {
+        m_sizes.erase(std::remove_if(m_sizes.begin(), m_sizes.end(), [](int s) { return s > 1024; }),
+                      m_sizes.end());
+        m_minSeconds = std::min(m_minSeconds, 0.1);
+    }
+    
+    if (parser.isSet(engines))
+    {
+        for (const QString& name : parser.value(engines).toLower().split(','))
+        {
+            int type = 0;
+            while (type < GOLEngine::TypeCount &&
+                   name.trimmed() != QString(GOLEngine::typeName((GOLEngine::Type)type)).toLower())
+                ++type;
+            
+            if (type == GOLEngine::TypeCount)
+            {
+                QTextStream(stderr) << "Unknown engine " << name << "\n";
+                return false;
+            }
+            
+            if (std::find(m_types.begin(), m_types.end(), (GOLEngine::Type)type) == m_types.end())
+                m_types.push_back((GOLEngine::Type)type);
+        }
+    }
+    else
+    {
+        for (int i = 0; i < GOLEngine::TypeCount; ++i)
+            m_types.push_back((GOLEngine::Type)i);
+    }
+    
+    if (parser.isSet(threads))
+    {
+        m_threads = parseList(parser.value(threads), &ok);
+        if (!ok || m_threads.empty())
+        {
+            QTextStream(stderr) << "Invalid thread counts " << parser.value(threads) << "\n";
+            return false;
+        }
+    }
+    else
+    {
+        // powers of two up to all cores
+        int cores = std::max(1, (int)std::thread::hardware_concurrency());
+        
+        for (int t = 1; t < cores; t *= 2)
+            m_threads.push_back(t);
+        m_threads.push_back(cores);
+    }
+    
+    return true;
+}
+
+
+void GOLBenchmark::runSizes()
+{
+    for (GOLEngine::Type type : m_types)
+    {
+        for (int p = 0; p < PatternCount; ++p)
+        {
+            for (int size : m_sizes)
+            {
+                if (size <= maxSize(type, (Pattern)p))
+                    report(measure("sizes", type, "B3/S23", (Pattern)p, size, 0));
+            }
+        }
+    }
+}
+
+void GOLBenchmark::runRules()
+{
+    const int size = std::min(1024, *std::max_element(m_sizes.begin(), m_sizes.end()));
+    
+    for (GOLEngine::Type type : m_types)
+    {
+        for (const char* text : s_rules)
+        {
+            GOLRule rule;
+            GOLRule::parse(text, rule);
+            
+            GOLEngine* engine = GOLEngine::create(type, 1, 1);
+            bool supported = engine->supportsRule(rule);
+            delete engine;
+            
+            if (supported)
+                report(measure("rules", type, text, Soup, std::min(size, maxSize(type, Soup)), 0));
+        }
+    }
+}
+
+void GOLBenchmark::runThreads()
+{
+    for (GOLEngine::Type type : m_types)
+    {
+        // HashLife runs on the calling thread only
+        if (type == GOLEngine::HashLife) { continue; }
+        
+        const int size = std::min(std::min(4096, *std::max_element(m_sizes.begin(), m_sizes.end())),
+                                  maxSize(type, Soup));
+        
+        for (int threads : m_threads)
+            report(measure("threads", type, "B3/S23", Soup, size, threads));
+    }
+    
+    GOLThreadPool::configure(0, GOLThreadPool::Unpinned);
+}
+
+
+// cells per second through each format, on a grid engine board
+void GOLBenchmark::runFiles()
+{
+    const QString dir = QDir::temp().filePath(QString("golbench_%1").arg(QCoreApplication::applicationPid()));
+    QDir().mkpath(dir);
+    
+    // the template and default colours of the render dialog
+    QString htmlTemplate;
+    QFile templateFile("template.html");
+    if (templateFile.open(QFile::ReadOnly | QFile::Text))
+        htmlTemplate = templateFile.readAll();
+    else
+        QTextStream(stderr) << "No template.html in the working directory, skipping HTML frames\n";
+    
+    const std::vector<QColor> colors = { QColor(255, 255, 255), QColor(255, 165, 0) };
+    
+    for (int p = 0; p < PatternCount; ++p)
+    {
+        for (int size : m_sizes)
+        {
+            if (size > 4096) { continue; }
+            
+            GOLEngine* engine = GOLEngine::create(GOLEngine::Grid, size, size);
+            fill(engine, (Pattern)p);
+            
+            bool* cells = new bool[(size_t)size * size];
+            engine->getRegion(0, 0, size, size, cells);
+            
+            std::vector<uint8_t> states((size_t)size * size);
+            engine->getStates(0, 0, size, size, states.data());
+            
+            const char* formats[] = { "gol", "rle", "png", "html", "svg" };
+            
+            for (const char* format : formats)
+            {
+                const QString path = QDir(dir).filePath(QString("board.%1").arg(format));
+                const bool html = QString(format) == "html", svg = QString(format) == "svg";
+                
+                // written only, the frames in one cell per pixel
+                const bool image = html || svg || QString(format) == "png";
+                
+                if ((html || svg) && size > BENCH_FRAME_SIZE) { continue; }
+                if (html && htmlTemplate.isEmpty()) { continue; }
+                
+                quint64 saves = 0, loads = 0;
+                double saveSeconds = 0.0, loadSeconds = 0.0;
+                bool success = true;
+                
+                QElapsedTimer timer;
+                timer.start();
+                
+                do
+                {
+                    if (html)
+                        success &= GOLFile::saveHTML(path, htmlTemplate, states.data(), size, size,
+                                                     0, 0, size, size, 1, colors, false);
+                    else if (svg)
+                        success &= GOLFile::saveSVG(path, states.data(), size, size,
+                                                    0, 0, size, size, 1, colors, false);
+                    else if (image)
+                        success &= GOLFile::saveImage(path, engine);
+                    else
+                        success &= GOLFile::save(path, cells, size, size);
+                    ++saves;
+                }
+                while (success && timer.nsecsElapsed() < m_minSeconds * 1e9);
+                
+                saveSeconds = timer.nsecsElapsed() / 1e9;
+                
+                if (!image && success)
+                {
+                    timer.start();
+                    
+                    do
+                    {
+                        int cols, rows;
+                        bool* loaded = GOLFile::load(path, cols, rows);
+                        success &= loaded != NULL && cols == size && rows == size &&
+                                   std::equal(cells, cells + (size_t)size * size, loaded);
+                        delete[] loaded;
+                        ++loads;
+                    }
+                    while (success && timer.nsecsElapsed() < m_minSeconds * 1e9);
+                    
+                    loadSeconds = timer.nsecsElapsed() / 1e9;
+                }
+                
+                const double boardCells = (double)size * size;
+                
+                QJsonObject result;
+                result["suite"] = "files";
+                result["format"] = format;
+                result["pattern"] = patternName((Pattern)p);
+                result["size"] = size;
+                result["bytes"] = (qint64)QFileInfo(path).size();
+                result["ok"] = success;
+                result["saveCellsPerSecond"] = saves * boardCells / saveSeconds;
+                if (!image)
+                    result["loadCellsPerSecond"] = loads * boardCells / loadSeconds;
+                
+                report(result);
+                
+                QFile::remove(path);
+            }
+            
+            delete[] cells;
+            delete engine;
+        }
+    }
+    
+    QDir().rmdir(dir);
+}
+
+
+// steps until m_minSeconds have passed, after one generation to warm up
+QJsonObject GOLBenchmark::measure(const QString& suite, GOLEngine::Type type, const QString& ruleText,
+                                  Pattern pattern, int size, int threads)
+{
+    if (threads > 0)
+        GOLThreadPool::configure(threads, GOLThreadPool::Unpinned);
+    
+    GOLRule rule;
+    GOLRule::parse(ruleText.toStdString(), rule);
+    
+    QElapsedTimer timer;
+    timer.start();
+    
+    GOLEngine* engine = GOLEngine::create(type, size, size);
+    engine->setRule(rule);
+    fill(engine, pattern);
+    
+    const double setupSeconds = timer.nsecsElapsed() / 1e9;
+    
+    engine->step();
+    
+    quint64 generations = 0;
+    timer.start();
+    
+    do
+    {
+        engine->step();
+        generations += engine->stepSize();
+    }
+    while (timer.nsecsElapsed() < m_minSeconds * 1e9);
+    
+    const double seconds = timer.nsecsElapsed() / 1e9;
+    
+    QJsonObject result;
+    result["suite"] = suite;
+    result["engine"] = GOLEngine::typeName(type);
+    result["rule"] = ruleText;
+    result["pattern"] = patternName(pattern);
+    result["size"] = size;
+    result["threads"] = GOLThreadPool::instance().threadCount();
+    result["generations"] = (qint64)generations;
+    result["seconds"] = seconds;
+    result["setupSeconds"] = setupSeconds;
+    result["generationsPerSecond"] = generations / seconds;
+    result["cellUpdatesPerSecond"] = (double)size * size * generations / seconds;
+    result["population"] = (qint64)engine->population();
+    if (engine->tileCount())
+        result["activeTiles"] = (double)engine->activeTiles() / engine->tileCount();
+    
+    delete engine;
+    
+    return result;
+}
+
+
+void GOLBenchmark::fill(GOLEngine* engine, Pattern pattern)
+{
+    const int cols = engine->columns(), rows = engine->rows();
+    bool* row = new bool[cols];
+    
+    if (pattern == Ash && m_ash.empty())
+        buildAsh();
+    
+    for (int y = 0; y < rows; ++y)
+    {
+        for (int x = 0; x < cols; ++x)
+            row[x] = cell(pattern, x, y);
+        
+        engine->setRegion(0, y, cols, 1, row);
+    }
+    
+    delete[] row;
+}
+
+bool GOLBenchmark::cell(Pattern pattern, int x, int y) const
+{
+    if (pattern == Ash)
+        return m_ash[(y % BENCH_ASH_SIZE) * BENCH_ASH_SIZE + x % BENCH_ASH_SIZE];
+    
+    uint64_t r = mix(((uint64_t)(uint32_t)y << 32 | (uint32_t)x) ^ BENCH_SEED) % 1000;
+    
+    return r < (pattern == Soup ? 300u : 20u);
+}
+
+// a soup run on a torus until it settled, so the tiles fit together
+void GOLBenchmark::buildAsh()
+{
+    GOLEngine* engine = GOLEngine::create(GOLEngine::Grid, BENCH_ASH_SIZE, BENCH_ASH_SIZE);
+    engine->setWrap(true);
+    
+    bool* cells = new bool[BENCH_ASH_SIZE * BENCH_ASH_SIZE];
+    
+    for (int i = 0; i < BENCH_ASH_SIZE * BENCH_ASH_SIZE; ++i)
+        cells[i] = cell(Soup, i % BENCH_ASH_SIZE, i / BENCH_ASH_SIZE);
+    
+    engine->setRegion(0, 0, BENCH_ASH_SIZE, BENCH_ASH_SIZE, cells);
+    
+    for (int g = 0; g < BENCH_ASH_GENS; ++g)
+        engine->step();
+    
+    engine->getRegion(0, 0, BENCH_ASH_SIZE, BENCH_ASH_SIZE, cells);
+    m_ash.assign(cells, cells + BENCH_ASH_SIZE * BENCH_ASH_SIZE);
+    
+    delete[] cells;
+    delete engine;
+}
+
+
+// the byte per cell engine and HashLife on noise would need more memory than
+// a benchmark machine can be expected to have
+int GOLBenchmark::maxSize(GOLEngine::Type type, Pattern pattern) const
+{
+    switch (type)
+    {
+        case GOLEngine::MultiState: return 4096;
+        case GOLEngine::HashLife:   return pattern == Ash ? 32768 : 4096;
+        default:                    return 32768;
+    }
+}
+
+void GOLBenchmark::report(const QJsonObject& result)
+{
+    m_results.append(result);
+    
+    // progress, the JSON goes out at the end
+    QTextStream(stderr) << QJsonDocument(result).toJson(QJsonDocument::Compact) << "\n";
+}
@@ -0,0 +1,93 @@
+#ifndef GOLBENCHMARK_H
+#define GOLBENCHMARK_H
+
+
+#define BENCH_MIN_SECONDS  0.5   // each measurement runs at least this long
+#define BENCH_ASH_SIZE     256   // side of the settled soup tiled over ash boards
+#define BENCH_ASH_GENS    2000
+#define BENCH_SEED        20190501
+#define BENCH_SUITES      "sizes,rules,threads,files"
+#define BENCH_FRAME_SIZE  1024  // largest board exported as HTML and SVG frames
+
+
+#include "golengine.h"
+
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QString>
+#include <QStringList>
+
+#include <vector>
+
+
+// Baseline numbers for every subsystem, written as JSON: cell updates per
+// second of the engines over board sizes, patterns, rules and thread counts,
+// and the throughput of the pattern files, image and frame export. Built as its own
+// target (GameOfLifeBench.pro), run with --help for the options.
+//
+// Suites:
+//   sizes    every engine on every size and pattern, Conway, all threads
+//   rules    every engine on each rule it can run, a 1024^2 soup
+//   threads  the threaded engines on a 4096^2 soup per thread count
+//   files    .gol / .rle save and load, PNG export and the HTML / SVG
+//            frames of the render dialog per size
+
+class GOLBenchmark
+{
+public:
+    
+    enum Pattern
+    {
+        Soup,   // 30% random
+        Sparse, // 2% random
+        Ash,    // what a soup leaves behind, still lifes, blinkers, gliders
+        PatternCount
+    };
+    
+    
+    GOLBenchmark();
+    
+    
+    // returns the exit code of the process
+    int run(const QStringList& arguments);
+    
+    static const char* patternName(Pattern pattern);
+    
+    
+private:
+    
+    // Methods:
+    
+    bool parse(const QStringList& arguments);
+    
+    void runSizes();
+    void runRules();
+    void runThreads();
+    void runFiles();
+    
+    QJsonObject measure(const QString& suite, GOLEngine::Type type, const QString& rule,
+                        Pattern pattern, int size, int threads);
+    
+    void fill(GOLEngine* engine, Pattern pattern);
+    bool cell(Pattern pattern, int x, int y) const;
+    void buildAsh();
+    
+    int maxSize(GOLEngine::Type type, Pattern pattern) const;
+    void report(const QJsonObject& result);
+    
+    
+    // Attributes:
+    
+    QStringList m_suites;
+    std::vector<GOLEngine::Type> m_types;
+    std::vector<int> m_sizes, m_threads;
+    double m_minSeconds;
+    QString m_output;
+    
+    std::vector<uint8_t> m_ash;
+    
+    QJsonArray m_results;
+    
+};
+
+#endif // GOLBENCHMARK_H
@@ -0,0 +1,174 @@
+#include "goldensity.h"
+
+#include <algorithm>
+
+
+GOLDensityPyramid::GOLDensityPyramid()
+ : m_cols(0)
+ , m_rows(0)
+{
+    m_stale.setAll();
+}
+
+
+void GOLDensityPyramid::setSize(int cols, int rows)
+{
+    m_cols = cols;
+    m_rows = rows;
+    
+    // allocated again by the next read()
+    for (int l = DENSITY_BASE_LEVEL; l <= DENSITY_LEVELS; ++l)
+        std::vector<uint32_t>().swap(m_levels[l].counts);
+    
+    m_stale.setAll();
+}
+
+void GOLDensityPyramid::markStale(const GOLDirtyRegion& region)
+{
+    m_stale.add(region);
+}
+
+
+void GOLDensityPyramid::read(const GOLEngine* engine, int level, int x, int y, int w, int h, uint8_t* density)
+{
+    if (w <= 0 || h <= 0) { return; }
+    
+    const uint32_t* counts;
+    int stride;
+    
+    if (level >= DENSITY_BASE_LEVEL)
+    {
+        refresh(engine);
+        
+        stride = m_levels[level].cols;
+        counts = &m_levels[level].counts[(size_t)y * stride + x];
+    }
+    else
+    {
+        // a few cells per block, counted right away
+        const GOLBounds board(0, 0, m_cols - 1, m_rows - 1);
+        
+        m_counts.assign((size_t)w * h, 0);
+        countCells(engine, GOLBounds(x << level, y << level, ((x + w) << level) - 1, ((y + h) << level) - 1).intersected(board),
+                   level, m_counts.data(), w);
+        
+        stride = w;
+        counts = m_counts.data();
+    }
+    
+    for (int j = 0; j < h; ++j)
+    {
+        const int y0 = (y + j) << level;
+        const int height = std::min(y0 + (1 << level), m_rows) - y0;
+        
+        for (int i = 0; i < w; ++i)
+        {
+            // blocks on the right and bottom edge are cut off by the board
+            const int x0 = (x + i) << level;
+            const uint64_t area = (uint64_t)(std::min(x0 + (1 << level), m_cols) - x0) * height;
+            const uint64_t count = counts[(size_t)j * stride + i];
+            
+            density[(size_t)j * w + i] = count ? (uint8_t)std::max<uint64_t>(1, count * 255 / area) : 0;
+        }
+    }
+}
+
+
+void GOLDensityPyramid::refresh(const GOLEngine* engine)
+{
+    const int b = DENSITY_BASE_LEVEL;
+    Level& base = m_levels[b];
+    
+    if (base.counts.empty())
+    {
+        for (int l = b; l <= DENSITY_LEVELS; ++l)
+        {
+            m_levels[l].cols = blocks(m_cols, l);
+            m_levels[l].rows = blocks(m_rows, l);
+            m_levels[l].counts.assign((size_t)m_levels[l].cols * m_levels[l].rows, 0);
+        }
+        
+        m_stale.setAll();
+    }
+    
+    if (m_stale.empty()) { return; }
+    
+    const GOLBounds board(0, 0, m_cols - 1, m_rows - 1);
+    const std::vector<GOLBounds> stale = m_stale.all ? std::vector<GOLBounds>(1, board) : m_stale.boxes;
+    
+    for (const GOLBounds& dirty : stale)
+    {
+        const GOLBounds box = dirty.intersected(board);
+        if (box.empty()) { continue; }
+        
+        // the whole blocks of the base level the box touches
+        const GOLBounds blocks(box.x0 >> b, box.y0 >> b, box.x1 >> b, box.y1 >> b);
+        const GOLBounds cells = GOLBounds(blocks.x0 << b, blocks.y0 << b, ((blocks.x1 + 1) << b) - 1,
+                                          ((blocks.y1 + 1) << b) - 1).intersected(board);
+        
+        for (int y = blocks.y0; y <= blocks.y1; ++y)
+            std::fill_n(&base.counts[(size_t)y * base.cols + blocks.x0], blocks.width(), 0);
+        
+        countCells(engine, cells, b, &base.counts[(size_t)blocks.y0 * base.cols + blocks.x0], base.cols);
+        
+        for (int l = b + 1; l <= DENSITY_LEVELS; ++l)
+            countLevel(l, GOLBounds(box.x0 >> l, box.y0 >> l, box.x1 >> l, box.y1 >> l));
+    }
+    
+    m_stale.clear();
+}
+
+// adds the living cells of the box to the counts of the blocks of a level it
+// lies in, counts starts at the block of its top left cell
+void GOLDensityPyramid::countCells(const GOLEngine* engine, const GOLBounds& box, int level, uint32_t* counts, int stride)
+{
+    if (box.empty()) { return; }
+    
+    const int w = box.width();
+    const int bx0 = box.x0 >> level, by0 = box.y0 >> level;
+    
+    m_band.resize((size_t)w * DENSITY_BAND_ROWS);
+    
+    for (int y0 = box.y0; y0 <= box.y1; y0 += DENSITY_BAND_ROWS)
+    {
+        const int h = std::min(DENSITY_BAND_ROWS, box.y1 - y0 + 1);
+        engine->getStates(box.x0, y0, w, h, m_band.data());
+        
+        for (int y = 0; y < h; ++y)
+        {
+            const uint8_t* row = &m_band[(size_t)y * w];
+            uint32_t* out = counts + (size_t)(((y0 + y) >> level) - by0) * stride;
+            
+            for (int x = 0; x < w; ++x)
+                out[((box.x0 + x) >> level) - bx0] += row[x] == 1;
+        }
+    }
+}
+
+// each block is the sum of the four below it
+void GOLDensityPyramid::countLevel(int level, const GOLBounds& blocks)
+{
+    Level& l = m_levels[level];
+    const Level& below = m_levels[level - 1];
+    
+    for (int y = blocks.y0; y <= blocks.y1; ++y)
+    {
+        for (int x = blocks.x0; x <= blocks.x1; ++x)
+        {
+            uint32_t sum = 0;
+            
+            for (int dy = 0; dy < 2; ++dy)
+            {
+                for (int dx = 0; dx < 2; ++dx)
+                {
+                    const int cx = 2 * x + dx, cy = 2 * y + dy;
+                    
+                    if (cx < below.cols && cy < below.rows)
+                        sum += below.counts[(size_t)cy * below.cols + cx];
+                }
+            }
+            
+            l.counts[(size_t)y * l.cols + x] = sum;
+        }
+    }
+}
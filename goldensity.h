@@ -0,0 +1,72 @@
+#ifndef GOLDENSITY_H
+#define GOLDENSITY_H
+
+
+#define DENSITY_BASE_LEVEL  2  // blocks of 4x4 cells, the finer levels are counted from the cells
+#define DENSITY_LEVELS     12  // the coarsest, blocks of 4096x4096 cells
+#define DENSITY_BAND_ROWS  64  // rows of cells read from the engine at once
+
+
+#include "golengine.h"
+#include "golframebuffer.h"
+
+#include <cstdint>
+#include <vector>
+
+
+// Living cells per block of 2^k x 2^k cells for the levels k from
+// DENSITY_BASE_LEVEL to DENSITY_LEVELS, for a board zoomed out to one pixel per
+// block. Each level is summed up from the one below it and the base level is
+// counted from the cells, both only where the board changed since the last
+// read(); while nothing is zoomed out it costs no more than merging the dirty
+// boxes of the frames.
+
+class GOLDensityPyramid
+{
+public:
+    
+    GOLDensityPyramid();
+    
+    
+    void setSize(int cols, int rows); // everything is stale
+    void markStale(const GOLDirtyRegion& region);
+    
+    // the w*h blocks of a level from block x, y as the share of living cells
+    // in them, 0 to 255, but at least 1 if any is alive
+    void read(const GOLEngine* engine, int level, int x, int y, int w, int h, uint8_t* density);
+    
+    // blocks of a level across a number of cells
+    static inline int blocks(int cells, int level) { return (cells + (1 << level) - 1) >> level; }
+    
+    
+private:
+    
+    struct Level
+    {
+        int cols, rows; // in blocks
+        std::vector<uint32_t> counts;
+    };
+    
+    
+    // Methods:
+    
+    void refresh(const GOLEngine* engine);
+    
+    // boxes in cells, sums only over cells within the board
+    void countCells(const GOLEngine* engine, const GOLBounds& box, int level, uint32_t* counts, int stride);
+    void countLevel(int level, const GOLBounds& blocks);
+    
+    
+    // Attributes:
+    
+    int m_cols, m_rows;
+    
+    Level m_levels[DENSITY_LEVELS + 1]; // from DENSITY_BASE_LEVEL on
+    GOLDirtyRegion m_stale;
+    
+    std::vector<uint8_t> m_band;
+    std::vector<uint32_t> m_counts;
+    
+};
+
+#endif // GOLDENSITY_H
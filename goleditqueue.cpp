@@ -0,0 +1,33 @@
+#include "goleditqueue.h"
+
+
+GOLEditQueue::GOLEditQueue()
+{
+    m_head.store(0);
+    m_tail.store(0);
+}
+
+
+bool GOLEditQueue::push(const GOLEdit& edit)
+{
+    unsigned tail = m_tail.load(std::memory_order_relaxed);
+    
+    if (tail - m_head.load(std::memory_order_acquire) == EDIT_QUEUE_SIZE) { return false; }
+    
+    m_edits[tail & (EDIT_QUEUE_SIZE - 1)] = edit;
+    m_tail.store(tail + 1, std::memory_order_release);
+    
+    return true;
+}
+
+bool GOLEditQueue::pop(GOLEdit& edit)
+{
+    unsigned head = m_head.load(std::memory_order_relaxed);
+    
+    if (head == m_tail.load(std::memory_order_acquire)) { return false; }
+    
+    edit = m_edits[head & (EDIT_QUEUE_SIZE - 1)];
+    m_head.store(head + 1, std::memory_order_release);
+    
+    return true;
+}
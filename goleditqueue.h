@@ -0,0 +1,43 @@
+#ifndef GOLEDITQUEUE_H
+#define GOLEDITQUEUE_H
+
+
+#define EDIT_QUEUE_SIZE  4096  // power of two
+
+
+#include <atomic>
+
+
+struct GOLEdit
+{
+    int x, y;
+    bool alive;
+};
+
+
+// Lock-free ring of cell edits from a single producer (the mouse handlers) to a
+// single consumer (the simulation, between two generations).
+
+class GOLEditQueue
+{
+public:
+    
+    GOLEditQueue();
+    
+    
+    bool push(const GOLEdit& edit); // false if full
+    bool pop(GOLEdit& edit);        // false if empty
+    
+    
+private:
+    
+    GOLEdit m_edits[EDIT_QUEUE_SIZE];
+    
+    // on separate cache lines, each side writes only one of them
+    std::atomic_uint m_head; // next to pop
+    char m_padding[64];
+    std::atomic_uint m_tail; // next to push
+    
+};
+
+#endif // GOLEDITQUEUE_H
@@ -0,0 +1,137 @@
+#include "golengine.h"
+#include "golgridengine.h"
+#include "golhashlife.h"
+#include "golsparseengine.h"
+#include "golmultistateengine.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+GOLEngine::GOLEngine(int cols, int rows)
+ : m_cols(cols)
+ , m_rows(rows)
+ , m_stepExponent(0)
+{
+}
+
+GOLEngine::~GOLEngine()
+{
+}
+
+
+GOLEngine* GOLEngine::create(Type type, int cols, int rows)
+{
+    switch (type)
+    {
+        case HashLife:   return new GOLHashLife(cols, rows);
+        case Sparse:     return new GOLSparseEngine(cols, rows);
+        case MultiState: return new GOLMultiStateEngine(cols, rows);
+        default:         return new GOLGridEngine(cols, rows);
+    }
+}
+
+const char* GOLEngine::typeName(Type type)
+{
+    switch (type)
+    {
+        case Grid:       return "Grid";
+        case HashLife:   return "HashLife";
+        case Sparse:     return "Infinite";
+        case MultiState: return "Multi-state";
+        default:         return "";
+    }
+}
+
+
+void GOLEngine::getRegion(int x, int y, int w, int h, bool* cells) const
+{
+    for (int i = 0; i < h; ++i)
+        for (int j = 0; j < w; ++j)
+            cells[i * w + j] = get(x + j, y + i);
+}
+
+void GOLEngine::setRegion(int x, int y, int w, int h, const bool* cells)
+{
+    for (int i = 0; i < h; ++i)
+        for (int j = 0; j < w; ++j)
+            set(x + j, y + i, cells[i * w + j]);
+}
+
+void GOLEngine::getStates(int x, int y, int w, int h, uint8_t* states) const
+{
+    bool* cells = new bool[w * h];
+    getRegion(x, y, w, h, cells);
+    
+    for (int i = 0; i < w * h; ++i)
+        states[i] = cells[i];
+    
+    delete[] cells;
+}
+
+void GOLEngine::setStates(int x, int y, int w, int h, const uint8_t* states)
+{
+    bool* cells = new bool[w * h];
+    
+    for (int i = 0; i < w * h; ++i)
+        cells[i] = states[i] == 1;
+    
+    setRegion(x, y, w, h, cells);
+    delete[] cells;
+}
+
+
+GOLBounds GOLEngine::bounds() const
+{
+    uint8_t* states = new uint8_t[m_cols];
+    GOLBounds bounds;
+    
+    for (int y = 0; y < m_rows; ++y)
+    {
+        getStates(0, y, m_cols, 1, states);
+        
+        for (int x = 0; x < m_cols; ++x)
+        {
+            if (states[x])
+                bounds.extend(x, y);
+        }
+    }
+    
+    delete[] states;
+    
+    return bounds;
+}
+
+// eight states to a word, GOLMultiStateEngine hashes the same way
+uint64_t GOLEngine::hash() const
+{
+    uint8_t* states = new uint8_t[m_cols];
+    uint64_t hash = 0;
+    
+    for (int y = 0; y < m_rows; ++y)
+    {
+        getStates(0, y, m_cols, 1, states);
+        
+        for (int x = 0; x < m_cols; x += 8)
+        {
+            uint64_t word = 0;
+            std::memcpy(&word, states + x, std::min(8, m_cols - x));
+            hash += hashWord(word, (uint64_t)y * m_cols + x);
+        }
+    }
+    
+    delete[] states;
+    
+    return hash;
+}
+
+
+void GOLEngine::setStepExponent(int exponent)
+{
+    m_stepExponent = std::max(0, std::min(exponent, maxStepExponent()));
+}
+
+void GOLEngine::setRule(const GOLRule& rule)
+{
+    m_rule = rule;
+}
@@ -0,0 +1,146 @@
+#ifndef GOLENGINE_H
+#define GOLENGINE_H
+
+
+#include "golrule.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+
+// Inclusive box of cells, empty while x1 < x0.
+struct GOLBounds
+{
+    int x0, y0, x1, y1;
+    
+    GOLBounds() : x0(0), y0(0), x1(-1), y1(-1) {}
+    GOLBounds(int x0, int y0, int x1, int y1) : x0(x0), y0(y0), x1(x1), y1(y1) {}
+    
+    inline bool empty() const { return x1 < x0 || y1 < y0; }
+    inline int width() const { return empty() ? 0 : x1 - x0 + 1; }
+    inline int height() const { return empty() ? 0 : y1 - y0 + 1; }
+    
+    inline void extend(int x, int y) { extend(GOLBounds(x, y, x, y)); }
+    inline void extend(const GOLBounds& b)
+    {
+        if (b.empty()) { return; }
+        if (empty()) { *this = b; return; }
+        
+        x0 = std::min(x0, b.x0);
+        y0 = std::min(y0, b.y0);
+        x1 = std::max(x1, b.x1);
+        y1 = std::max(y1, b.y1);
+    }
+    
+    inline GOLBounds intersected(const GOLBounds& b) const
+    {
+        return GOLBounds(std::max(x0, b.x0), std::max(y0, b.y0), std::min(x1, b.x1), std::min(y1, b.y1));
+    }
+};
+
+
+// Interface of the simulation backends behind GOLScene. The board is the
+// rectangle [0, columns()) x [0, rows()) that is shown and edited; engines
+// are not thread-safe, GOLScene serialises all access with m_cellsMutex.
+
+class GOLEngine
+{
+public:
+    
+    enum Type { Grid, HashLife, Sparse, MultiState, TypeCount };
+    
+    static GOLEngine* create(Type type, int cols, int rows);
+    static const char* typeName(Type type);
+    
+    
+    virtual ~GOLEngine();
+    
+    virtual Type type() const = 0;
+    
+    inline int columns() const { return m_cols; }
+    inline int rows() const { return m_rows; }
+    virtual void setSize(int cols, int rows) = 0; // keeps the overlapping region
+    
+    virtual void clear() = 0;
+    
+    virtual bool get(int x, int y) const = 0;
+    virtual void set(int x, int y, bool alive) = 0;
+    
+    // reads / writes the w*h cells (row-major) of a region within the board
+    virtual void getRegion(int x, int y, int w, int h, bool* cells) const;
+    virtual void setRegion(int x, int y, int w, int h, const bool* cells);
+    
+    // the same with the state of each cell: 0 is dead, 1 alive and 2 up to
+    // rule().states-1 are the dying states of Generations rules
+    virtual void getStates(int x, int y, int w, int h, uint8_t* states) const;
+    virtual void setStates(int x, int y, int w, int h, const uint8_t* states);
+    
+    // one step() advances the board by 2^stepExponent() generations
+    inline int stepExponent() const { return m_stepExponent; }
+    inline uint64_t stepSize() const { return (uint64_t)1 << m_stepExponent; }
+    virtual int maxStepExponent() const { return 0; }
+    virtual void setStepExponent(int exponent);
+    
+    // the two-state engines run Life-like rules only
+    virtual bool supportsRule(const GOLRule& rule) const { return rule.isLifeLike(); }
+    inline const GOLRule& rule() const { return m_rule; }
+    virtual void setRule(const GOLRule& rule);
+    
+    virtual void step() = 0;
+    
+    // the board of the grid engine can wrap around into a torus, the
+    // unbounded engines have no edges to wrap
+    virtual bool canWrap() const { return false; }
+    virtual bool wraps() const { return false; }
+    virtual void setWrap(bool) {}
+    
+    // living cells, kept exact through step() and edits alike; those of the
+    // unbounded engines beyond the board count as well
+    virtual uint64_t population() const = 0;
+    
+    // living cells on the board only, what the window shows
+    virtual uint64_t boardPopulation() const { return population(); }
+    
+    // box of the cells on the board that are not dead, exact after step();
+    // edits only grow it, so it may be too large until the next one. The
+    // default reads the board.
+    virtual GOLBounds bounds() const;
+    
+    // tiles recomputed by the last step() out of tileCount(), 0 if not tiled
+    virtual uint64_t activeTiles() const { return 0; }
+    virtual uint64_t tileCount() const { return 0; }
+    
+    // appends boxes on the board that hold every cell the last step() changed,
+    // tiles that did not change are left out; false if the engine does not
+    // keep track of them
+    virtual bool changedRegions(std::vector<GOLBounds>&) const { return false; }
+    
+    // Zobrist-style hash of the generation, a sum of hashWord() over the words
+    // of cells. The engines sum it up per tile while stepping, so like the
+    // population it is current after step() only; the default reads the board.
+    virtual uint64_t hash() const;
+    
+    
+protected:
+    
+    GOLEngine(int cols, int rows);
+    
+    // a word of cells at a position, dead words add nothing
+    static inline uint64_t hashWord(uint64_t word, uint64_t position)
+    {
+        word ^= word >> 33;
+        word *= 0xff51afd7ed558ccdULL;
+        word ^= word >> 33;
+        word *= 0xc4ceb9fe1a85ec53ULL;
+        word ^= word >> 33;
+        
+        return word * (2 * position + 1);
+    }
+    
+    int m_cols, m_rows, m_stepExponent;
+    GOLRule m_rule;
+    
+};
+
+#endif // GOLENGINE_H
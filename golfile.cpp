@@ -0,0 +1,503 @@
+#include "golfile.h"
+#include "goltrace.h"
+
+#include <QFile>
+#include <QDataStream>
+#include <QTextStream>
+#include <QImage>
+#include <QPainter>
+#include <QSvgGenerator>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+
+// the cell on disk of a state, .gol files and two-state RLE know only living
+// cells and dead ones
+static inline bool alive(bool cell) { return cell; }
+static inline bool alive(uint8_t cell) { return cell == 1; }
+
+// the tag of a state in the RLE of Golly's multi-state rules: "." for dead,
+// A-X for states 1 to 24, with a prefix p-y for those above
+static QString stateTag(int state)
+{
+    if (state == 0) { return "."; }
+    
+    QString tag(QChar('A' + (state - 1) % 24));
+    
+    return state > 24 ? QChar('p' + (state - 25) / 24) + tag : tag;
+}
+
+template <typename Cell>
+static bool saveCells(const QString& path, const Cell* cells, int cols, int rows, int states, const QString& rule)
+{
+    GOLTraceScope scope("save");
+    
+    QFile file(path);
+    if (!file.open(QFile::WriteOnly)) { return false; }
+    
+    QByteArray data;
+    
+    if (path.toLower().endsWith(".rle"))
+    {
+        QTextStream out(&data, QIODevice::WriteOnly);
+        out << "x = " << cols << ", y = " << rows;
+        if (!rule.isEmpty())
+            out << ", rule = " << rule;
+        out << "\n";
+        
+        QString line;
+        int blankRows = 0;
+        
+        // a run is <count><tag>, the count is left out when it is 1
+        auto addRun = [&](int count, const QString& tag)
+        {
+            QString run = (count > 1 ? QString::number(count) : QString()) + tag;
+            
+            if (line.size() + run.size() > RLE_LINE_LENGTH)
+            {
+                out << line << "\n";
+                line.clear();
+            }
+            line += run;
+        };
+        
+        for (int y = 0; y < rows; ++y)
+        {
+            const Cell* row = cells + (size_t)y * cols;
+            
+            int end = cols;
+            while (end > 0 && !row[end - 1]) { --end; }
+            
+            // trailing dead cells and empty rows add to the next row break
+            if (end == 0)
+            {
+                ++blankRows;
+                continue;
+            }
+            
+            if (y > blankRows)
+                addRun(blankRows + 1, "$");
+            else if (blankRows > 0)
+                addRun(blankRows, "$");
+            blankRows = 0;
+            
+            for (int x = 0; x < end;)
+            {
+                int run = 1;
+                while (x + run < end && row[x + run] == row[x]) { ++run; }
+                
+                if (states > 2)
+                    addRun(run, stateTag(row[x]));
+                else
+                    addRun(run, alive(row[x]) ? "o" : "b");
+                x += run;
+            }
+        }
+        
+        out << line << "!\n";
+    }
+    else
+    {
+        QDataStream out(&data, QIODevice::WriteOnly);
+        out << rows << cols;
+        
+        for (int i = 0; i < rows * cols; ++i)
+            out << alive(cells[i]);
+    }
+    
+    bool success = file.write(data) == data.size();
+    file.close();
+    
+    return success;
+}
+
+static bool* toCells(uint8_t* states, int cols, int rows)
+{
+    if (!states) { return NULL; }
+    
+    bool* cells = new bool[(size_t)cols * rows];
+    for (size_t i = 0; i < (size_t)cols * rows; ++i)
+        cells[i] = states[i] == 1;
+    
+    delete[] states;
+    
+    return cells;
+}
+
+
+bool* GOLFile::load(const QString& path, int& cols, int& rows, QString* rule)
+{
+    return toCells(loadStates(path, cols, rows, rule), cols, rows);
+}
+
+uint8_t* GOLFile::loadStates(const QString& path, int& cols, int& rows, QString* rule)
+{
+    GOLTraceScope scope("load");
+    
+    uint8_t* cells = NULL;
+    
+    QFile file(path);
+    if (file.open(QFile::ReadOnly))
+    {
+        if (path.toLower().endsWith(".gol"))
+        {
+            QByteArray data = file.readAll();
+            QDataStream in(&data, QIODevice::ReadOnly);
+            
+            in >> rows >> cols;
+            
+            cells = new uint8_t[cols * rows];
+            
+            for (int i = 0; i < cols * rows; ++i)
+            {
+                bool cell;
+                in >> cell;
+                cells[i] = cell;
+            }
+        }
+        else if (path.toLower().endsWith(".rle"))
+        {
+            cells = fromRleStates(file.readAll(), cols, rows, rule);
+        }
+        
+        file.close();
+    }
+    
+    return cells;
+}
+
+bool* GOLFile::fromRle(const QByteArray& data, int& cols, int& rows, QString* rule)
+{
+    return toCells(fromRleStates(data, cols, rows, rule), cols, rows);
+}
+
+// the RLE text of a pattern, Golly's header line and "!" terminated
+uint8_t* GOLFile::fromRleStates(const QByteArray& data, int& cols, int& rows, QString* rule)
+{
+    uint8_t* cells = NULL;
+    
+    QTextStream in(data, QIODevice::ReadOnly);
+    
+    bool header = false;
+    int x = 0, y = 0, count = 1, prefix = 0;
+    QString countStr = "";
+    bool endMarker = false;
+    
+    while (!in.atEnd() && !endMarker)
+    {
+        QString line = in.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith('#')) { continue; }
+        
+        if (!header && line.startsWith("x"))
+        {
+            QString str = line.left(line.indexOf(","));
+            cols = str.right(str.size() - str.indexOf("=") - 1).trimmed().toInt();
+            str = line.right(line.size() - str.size() - 1);
+            str = str.left(str.indexOf(","));
+            rows = str.right(str.size() - str.indexOf("=") - 1).trimmed().toInt();
+            header = true;
+            
+            // e.g. "rule = B36/S23", bounded grid suffixes (":T...") are dropped
+            int ruleIndex = line.indexOf("rule");
+            if (rule && ruleIndex >= 0)
+            {
+                str = line.mid(line.indexOf("=", ruleIndex) + 1);
+                *rule = str.left(str.indexOf(":")).trimmed();
+            }
+            
+            cells = new uint8_t[cols * rows];
+            memset(cells, 0, sizeof(uint8_t)*cols*rows);
+        }
+        else
+        {
+            for (int i = 0; i < line.size(); ++i)
+            {
+                QChar c = line[i];
+                const char ch = c.toLatin1();
+                
+                // multi-state tags: "." dead, A-X, p-y in front of those above
+                const bool tag = ch == 'b' || ch == 'o' || ch == '.' || (ch >= 'A' && ch <= 'X');
+                
+                if (ch >= 'p' && ch <= 'y')
+                {
+                    prefix = (ch - 'p' + 1) * 24;
+                }
+                else if (tag || ch == '$')
+                {
+                    if (!countStr.isEmpty())
+                    {
+                        count = countStr.toInt();
+                        countStr = "";
+                    }
+                    
+                    uint8_t state = 0;
+                    if (ch == 'o')
+                        state = 1;
+                    else if (ch >= 'A' && ch <= 'X')
+                        state = (uint8_t)std::min(prefix + ch - 'A' + 1, 255);
+                    prefix = 0;
+                    
+                    for (int j = 0; j < count; ++j)
+                    {
+                        if (ch == '$')
+                        {
+                            x = 0;
+                            ++y;
+                            if (y >= rows)
+                            {
+                                i = line.size();
+                                endMarker = true;
+                            }
+                        }
+                        else
+                        {
+                            if (x >= cols)
+                            {
+                                ++y;
+                                x = 0;
+                            }
+                            cells[y * cols + x] = state;
+                            ++x;
+                            if (y >= rows)
+                            {
+                                i = line.size();
+                                endMarker = true;
+                            }
+                        }
+                    }
+                    count = 1;
+                }
+                else if (c.isDigit())
+                {
+                    countStr += c;
+                }
+                else if (c == '!')
+                {
+                    endMarker = true;
+                    break;
+                }
+            }
+        }
+    }
+    
+    return cells;
+}
+
+
+bool GOLFile::save(const QString& path, const bool* cells, int cols, int rows, const QString& rule)
+{
+    return saveCells(path, cells, cols, rows, 2, rule);
+}
+
+bool GOLFile::saveStates(const QString& path, const uint8_t* cells, int cols, int rows, int states,
+                         const QString& rule)
+{
+    return saveCells(path, cells, cols, rows, states, rule);
+}
+
+
+// a square of cellSize pixels per cell in the colours of GOLScene
+bool GOLFile::saveImage(const QString& path, const GOLEngine* engine, int cellSize)
+{
+    GOLTraceScope scope("save image");
+    
+    const int states = engine->rule().states;
+    
+    std::vector<QRgb> colors(states);
+    colors[0] = qRgb(255, 255, 255);
+    for (int s = 1; s < states; ++s)
+    {
+        int alpha = s == 1 ? 255 : 40 + 160 * (states - s) / (states - 1);
+        colors[s] = qRgb(255, 255 - (255 - 165) * alpha / 255, 255 - 255 * alpha / 255);
+    }
+    
+    QImage image(engine->columns() * cellSize, engine->rows() * cellSize, QImage::Format_RGB32);
+    image.fill(colors[0]);
+    
+    // only the rows of the living cells are read
+    const GOLBounds live = engine->bounds();
+    std::vector<uint8_t> row(live.width());
+    
+    for (int y = live.y0; y <= live.y1; ++y)
+    {
+        engine->getStates(live.x0, y, live.width(), 1, row.data());
+        
+        for (int x = 0; x < live.width(); ++x)
+        {
+            if (!row[x]) { continue; }
+            
+            for (int py = 0; py < cellSize; ++py)
+            {
+                QRgb* line = (QRgb*)image.scanLine(y * cellSize + py);
+                std::fill(line + (live.x0 + x) * cellSize, line + (live.x0 + x + 1) * cellSize, colors[row[x]]);
+            }
+        }
+    }
+    
+    return image.save(path);
+}
+
+
+bool GOLFile::saveHTML(const QString& filepath, const QString& htmlTemplate,
+                       const uint8_t* cells, const int cols, const int rows,
+                       const int x, const int y, const int width, const int height,
+                       const int cellSize, const std::vector<QColor>& colors,
+                       const bool showGrid)
+{
+    GOLTraceScope scope("save html");
+    
+    QString html = htmlTemplate;
+    
+    if (showGrid)
+        html.replace("[borderstyle]", "border: 1px solid black;");
+    else
+        html.replace("[borderstyle]", "border: 0px solid transparent;");
+    
+    html.replace("[cellsize]", QString("%1px").arg(cellSize));
+    
+    html.replace("[cellcolor]", colors[1].name());
+    html.replace("[bgcolor]", colors[0].name());
+    
+    
+    QString cellTable;
+    
+    for (int r = y; r < std::min(y + height, rows); ++r)
+    {
+        cellTable += "\t<tr>\n";
+        
+        for (int c = x; c < std::min(x + width, cols); ++c)
+        {
+            const uint8_t state = cells[r * cols + c];
+            
+            if (state == 1)
+                cellTable += "\t\t<td class=filled></td>\n";
+            else if (state)
+                cellTable += QString("\t\t<td style=\"background-color: %1;\"></td>\n").arg(colors[state].name());
+            else
+                cellTable += "\t\t<td></td>\n";
+        }
+        
+        cellTable += "\t</tr>\n";
+    }
+    
+    html.replace("[celltable]", cellTable);
+    
+    QFile file(filepath);
+    if (file.open(QIODevice::WriteOnly | QIODevice::Text))
+    {
+        QTextStream out(&file);
+        out << html;
+        file.close();
+    }
+    else
+        return false;
+    
+    return true;
+}
+
+bool GOLFile::saveSVG(const QString& filepath,
+                      const uint8_t* cells, const int cols, const int rows,
+                      const int x, const int y, const int width, const int height,
+                      const int cellSize, const std::vector<QColor>& colors,
+                      const bool showGrid)
+{
+    GOLTraceScope scope("save svg");
+    
+    QFile file(filepath);
+    if (file.open(QIODevice::WriteOnly))
+    {
+        QRect viewRect(0, 0, width * cellSize, height * cellSize);
+        
+        QSvgGenerator generator;
+        generator.setOutputDevice(&file);
+        generator.setSize(QSize(width * cellSize, height * cellSize));
+        generator.setViewBox(viewRect);
+        generator.setDescription("Generated by Pascal Sielski's Game Of Life Demo (2019)");
+        
+        QPainter painter;
+        painter.begin(&generator);
+        
+        painter.fillRect(viewRect, colors[0]);
+        
+        for (int r = y; r < std::min(y + height, rows); ++r)
+        {
+            for (int c = x; c < std::min(x + width, cols); ++c)
+            {
+                if (cells[r * cols + c])
+                    painter.fillRect(QRect((c-x) * cellSize, (r-y) * cellSize,
+                                           cellSize, cellSize), colors[cells[r * cols + c]]);
+            }
+        }
+        
+        if (showGrid)
+        {
+            QPen pen(Qt::black, 1);
+            painter.setPen(pen);
+            
+            for (int i = 0; i < width; ++i)
+                painter.drawLine(i * cellSize, 0, i * cellSize, height * cellSize);
+            painter.drawLine(width * cellSize - 1, 0, width * cellSize - 1, height * cellSize);
+            
+            for (int i = 0; i < height; ++i)
+                painter.drawLine(0, i * cellSize, width * cellSize, i * cellSize);
+            painter.drawLine(0, height * cellSize, width * cellSize, height * cellSize);
+        }
+        
+        painter.end();
+    }
+    else
+    {
+        return false;
+    }
+    
+    return true;
+}
+
+
+bool* GOLFile::rotate(bool* cells, int& cols, int& rows, int rotation)
+{
+    rotation = rotation % 4;
+    if (rotation <= 0) { return cells; }
+    
+    int ncols = cols, nrows = rows;
+    
+    if (rotation == 1 || rotation == 3)
+    {
+        ncols = rows; nrows = cols;
+    }
+    
+    bool* ncells = new bool[ncols * nrows];
+    
+    auto f = [&](int x, int y) -> int
+    {
+        int nx, ny;
+        
+        if (rotation == 1)
+        {
+            nx = ncols - y - 1;
+            ny = x;
+        }
+        else if (rotation == 2)
+        {
+            nx = ncols - x - 1;
+            ny = nrows - y - 1;
+        }
+        else if (rotation == 3)
+        {
+            nx = y;
+            ny = nrows - x - 1;
+        }
+        
+        return ny * ncols + nx;
+    };
+    
+    for (int y = 0; y < rows; ++y)
+        for (int x = 0; x < cols; ++x)
+            ncells[f(x,y)] = cells[y * cols + x];
+    
+    rows = nrows;
+    cols = ncols;
+    return ncells;
+}
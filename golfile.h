@@ -0,0 +1,65 @@
+#ifndef GOLFILE_H
+#define GOLFILE_H
+
+
+#define RLE_LINE_LENGTH  70  // longest line of a written RLE file
+
+
+#include "golengine.h"
+
+#include <QByteArray>
+#include <QColor>
+#include <QString>
+
+#include <cstdint>
+#include <vector>
+
+
+// Patterns on disk: .gol files (QDataStream of rows, columns and a bool per
+// cell) and the RLE format of Golly and the pattern collections, with the
+// tags of its multi-state rules. Cells are row-major arrays owned by the
+// caller.
+
+class GOLFile
+{
+public:
+    
+    // NULL if the file cannot be read, the rule of an RLE header goes to rule;
+    // cells in states other than living ones are dead
+    static bool* load(const QString& path, int& cols, int& rows, QString* rule = NULL);
+    static bool* fromRle(const QByteArray& data, int& cols, int& rows, QString* rule = NULL);
+    
+    // the states of every cell, from two-state RLE as well
+    static uint8_t* loadStates(const QString& path, int& cols, int& rows, QString* rule = NULL);
+    static uint8_t* fromRleStates(const QByteArray& data, int& cols, int& rows, QString* rule = NULL);
+    
+    // RLE if the path ends with .rle, .gol otherwise
+    static bool save(const QString& path, const bool* cells, int cols, int rows, 
+                     const QString& rule = QString());
+    
+    // the multi-state RLE of Golly if there are more than two states, .gol
+    // files keep the living cells only
+    static bool saveStates(const QString& path, const uint8_t* cells, int cols, int rows, int states,
+                           const QString& rule = QString());
+    
+    // the board as an image, PNG and the other formats of QImage by suffix
+    static bool saveImage(const QString& path, const GOLEngine* engine, int cellSize = 1);
+    
+    // a frame of the render dialog, the cells in x, y, width, height of a
+    // row-major board of states; colors holds the background and the colour
+    // of every state after it
+    static bool saveHTML(const QString& path, const QString& htmlTemplate,
+                         const uint8_t* cells, int cols, int rows,
+                         int x, int y, int width, int height,
+                         int cellSize, const std::vector<QColor>& colors, bool showGrid);
+    static bool saveSVG(const QString& path,
+                        const uint8_t* cells, int cols, int rows,
+                        int x, int y, int width, int height,
+                        int cellSize, const std::vector<QColor>& colors, bool showGrid);
+    
+    // by rotation quarter turns clockwise, into a new array
+    static bool* rotate(bool* cells, int& cols, int& rows, int rotation);
+    
+};
+
+#endif // GOLFILE_H
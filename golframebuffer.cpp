@@ -0,0 +1,97 @@
+#include "golframebuffer.h"
+
+
+void GOLDirtyRegion::add(const GOLBounds& box)
+{
+    if (all || box.empty()) { return; }
+    
+    // boxes that overlap or touch the new one are taken into it, which may
+    // make it reach further ones
+    GOLBounds merged = box;
+    
+    for (size_t i = 0; i < boxes.size();)
+    {
+        const GOLBounds& b = boxes[i];
+        
+        if (b.x0 <= merged.x1 + 1 && merged.x0 <= b.x1 + 1 && b.y0 <= merged.y1 + 1 && merged.y0 <= b.y1 + 1)
+        {
+            merged.extend(b);
+            boxes[i] = boxes.back();
+            boxes.pop_back();
+            i = 0;
+        }
+        else
+            ++i;
+    }
+    
+    boxes.push_back(merged);
+    
+    if (boxes.size() > DIRTY_BOXES)
+    {
+        for (size_t i = 1; i < boxes.size(); ++i)
+            boxes[0].extend(boxes[i]);
+        
+        boxes.resize(1);
+    }
+}
+
+void GOLDirtyRegion::add(const GOLDirtyRegion& region)
+{
+    if (region.all)
+        setAll();
+    
+    for (const GOLBounds& box : region.boxes)
+        add(box);
+}
+
+
+GOLFrameBuffer::GOLFrameBuffer()
+ : m_back(0)
+ , m_front(1)
+{
+    m_middle.store(2);
+    
+    for (int i = 0; i < 5; ++i)
+        m_region[i].store(0);
+}
+
+
+bool GOLFrameBuffer::publish()
+{
+    const int previous = m_middle.exchange(m_back | FRAME_FRESH, std::memory_order_acq_rel);
+    
+    m_back = previous & 3;
+    return !(previous & FRAME_FRESH);
+}
+
+void GOLFrameBuffer::requestedRegion(int& x, int& y, int& w, int& h, int& level) const
+{
+    x = m_region[0].load(std::memory_order_relaxed);
+    y = m_region[1].load(std::memory_order_relaxed);
+    w = m_region[2].load(std::memory_order_relaxed);
+    h = m_region[3].load(std::memory_order_relaxed);
+    level = m_region[4].load(std::memory_order_relaxed);
+}
+
+
+const GOLFrame& GOLFrameBuffer::latest(bool* fresh)
+{
+    const bool available = m_middle.load(std::memory_order_relaxed) & FRAME_FRESH;
+    
+    if (available)
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & 3;
+    
+    if (fresh)
+        *fresh = available;
+    
+    return m_frames[m_front];
+}
+
+void GOLFrameBuffer::requestRegion(int x, int y, int w, int h, int level)
+{
+    m_region[0].store(x, std::memory_order_relaxed);
+    m_region[1].store(y, std::memory_order_relaxed);
+    m_region[2].store(w, std::memory_order_relaxed);
+    m_region[3].store(h, std::memory_order_relaxed);
+    m_region[4].store(level, std::memory_order_relaxed);
+}
@@ -0,0 +1,125 @@
+#ifndef GOLFRAMEBUFFER_H
+#define GOLFRAMEBUFFER_H
+
+
+#define FRAME_FRESH  4  // set on the middle index while the consumer has not taken it
+#define DIRTY_BOXES 16  // a dirty region with more boxes becomes their bounding box
+
+
+#include "golengine.h"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+
+// What the engine knows about a generation anyway, published with every frame
+// so the GUI needs neither the lock nor a signal per counter.
+struct GOLStats
+{
+    uint64_t generation, population; // on the board
+    uint64_t universe;               // living cells beyond the board as well
+    uint64_t activeTiles, tileCount;
+    GOLBounds bounds; // cells outside are dead
+    
+    GOLStats() : generation(0), population(0), universe(0), activeTiles(0), tileCount(0) {}
+};
+
+
+// Cells that changed, as boxes that neither overlap nor touch. Too many of
+// them are merged into one, so it always covers the cells and stays cheap to
+// pass along and to repaint.
+struct GOLDirtyRegion
+{
+    bool all; // the whole board, boxes is empty then
+    std::vector<GOLBounds> boxes;
+    
+    GOLDirtyRegion() : all(false) {}
+    
+    inline bool empty() const { return !all && boxes.empty(); }
+    inline void clear() { all = false; boxes.clear(); }
+    inline void setAll() { all = true; boxes.clear(); }
+    
+    void add(const GOLBounds& box);
+    void add(const GOLDirtyRegion& region);
+};
+
+
+// A generation as published for the renderer: the states of the region of the
+// board it asked for last and the stats that go with them. Zoomed out, the
+// region is in blocks of 2^level x 2^level cells and cells holds the density
+// of each block (GOLDensityPyramid::read()) instead of a state.
+struct GOLFrame
+{
+    int x, y, width, height;
+    int level;
+    int cols, rows; // of the board, in cells
+    int states;     // of the rule
+    
+    GOLStats stats;
+    
+    // cells of the board that changed since the last frame the renderer took,
+    // more if it is not known which one that was
+    GOLDirtyRegion dirty;
+    
+    std::vector<uint8_t> cells;
+    std::vector<uint32_t> pixels; // the cells as premultiplied ARGB, added by the render thread
+    
+    GOLFrame()
+     : x(0), y(0), width(0), height(0), level(0), cols(0), rows(0), states(2)
+    {
+    }
+    
+    inline bool contains(int cx, int cy) const
+    {
+        return cx >= x && cy >= y && cx < x + width && cy < y + height;
+    }
+    
+    inline uint8_t state(int cx, int cy) const { return cells[(cy - y) * width + cx - x]; }
+};
+
+
+// Lock-free triple buffer between the simulation, which fills back() and
+// publish()es it, and the renderer, which takes the newest published frame with
+// latest(). Neither side ever waits for the other, frames the renderer did not
+// get to are simply overwritten.
+//
+// The renderer also tells the simulation which region it wants through
+// requestRegion(), a torn read of it only costs one frame of the wrong region.
+
+class GOLFrameBuffer
+{
+public:
+    
+    GOLFrameBuffer();
+    
+    
+    // producer
+    
+    inline GOLFrame& back() { return m_frames[m_back]; }
+    bool publish(); // false if the frame published before was never taken
+    
+    void requestedRegion(int& x, int& y, int& w, int& h, int& level) const;
+    
+    
+    // consumer
+    
+    // fresh tells if the frame is one that was not taken before
+    const GOLFrame& latest(bool* fresh = nullptr);
+    inline const GOLFrame& front() const { return m_frames[m_front]; } // the one taken last
+    
+    void requestRegion(int x, int y, int w, int h, int level = 0);
+    
+    
+private:
+    
+    GOLFrame m_frames[3];
+    
+    int m_back, m_front;
+    std::atomic_int m_middle;
+    
+    std::atomic_int m_region[5];
+    
+};
+
+#endif // GOLFRAMEBUFFER_H
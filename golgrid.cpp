@@ -0,0 +1,204 @@
+#include "golgrid.h"
+#include "golthreadpool.h"
+#include "goltrace.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+GOLGrid::GOLGrid()
+ : m_cols(0)
+ , m_rows(0)
+ , m_words(0)
+ , m_stride(2)
+ , m_data(new uint64_t[2 * 2]())
+{
+}
+
+GOLGrid::GOLGrid(int cols, int rows)
+ : GOLGrid()
+{
+    resize(cols, rows);
+}
+
+GOLGrid::~GOLGrid()
+{
+    delete[] m_data;
+}
+
+
+void GOLGrid::resize(int cols, int rows)
+{
+    if (cols == m_cols && rows == m_rows) { return; }
+    
+    int words = (cols + 63) / 64;
+    int stride = words + 2;
+    
+    uint64_t* data = allocate(stride, rows + 2);
+    
+    int copyRows = std::min(rows, m_rows);
+    int copyWords = std::min(words, m_words);
+    
+    for (int y = 0; y < copyRows; ++y)
+    {
+        uint64_t* dst = &data[(size_t)(y+1) * stride + 1];
+        std::memcpy(dst, row(y), sizeof(uint64_t) * copyWords);
+        
+        if (cols < m_cols && copyWords > 0)
+        {
+            dst[copyWords-1] &= (cols & 63) ? (((uint64_t)1 << (cols & 63)) - 1)
+                                            : ~(uint64_t)0;
+        }
+    }
+    
+    delete[] m_data;
+    m_data = data;
+    m_cols = cols;
+    m_rows = rows;
+    m_words = words;
+    m_stride = stride;
+}
+
+void GOLGrid::clear()
+{
+    zero(m_data, m_stride, m_rows + 2);
+}
+
+void GOLGrid::swap(GOLGrid& other)
+{
+    std::swap(m_cols, other.m_cols);
+    std::swap(m_rows, other.m_rows);
+    std::swap(m_words, other.m_words);
+    std::swap(m_stride, other.m_stride);
+    std::swap(m_data, other.m_data);
+}
+
+
+// the pages of a fresh allocation are placed by the first write to them, which
+// zero() does in the same bands the engines step in
+uint64_t* GOLGrid::allocate(int stride, int rows)
+{
+    uint64_t* data = new uint64_t[(size_t)stride * rows];
+    zero(data, stride, rows);
+    
+    return data;
+}
+
+void GOLGrid::zero(uint64_t* data, int stride, int rows)
+{
+    const int bands = (rows + GRID_BAND_ROWS - 1) / GRID_BAND_ROWS;
+    
+    GOLThreadPool::instance().run(bands, [=](int band)
+    {
+        GOLTraceScope scope("zero band", band);
+        
+        int y0 = band * GRID_BAND_ROWS;
+        int y1 = std::min(y0 + GRID_BAND_ROWS, rows);
+        
+        std::memset(data + (size_t)y0 * stride, 0, sizeof(uint64_t) * stride * (y1 - y0));
+    });
+}
+
+
+void GOLGrid::clearHalo()
+{
+    const uint64_t tail = tailMask();
+    
+    std::fill(row(-1) - 1, row(-1) - 1 + m_stride, 0);
+    std::fill(row(m_rows) - 1, row(m_rows) - 1 + m_stride, 0);
+    
+    for (int y = 0; y < m_rows; ++y)
+    {
+        uint64_t* r = row(y);
+        
+        r[-1] = 0;
+        r[m_words] = 0;
+        
+        if (m_words > 0)
+            r[m_words-1] &= tail;
+    }
+}
+
+void GOLGrid::wrapHalo()
+{
+    if (m_cols == 0 || m_rows == 0) { return; }
+    
+    const uint64_t tail = tailMask();
+    const int last = m_words - 1;
+    
+    for (int y = 0; y < m_rows; ++y)
+    {
+        uint64_t* r = row(y);
+        uint64_t first = r[0] & 1;
+        
+        r[-1] = (uint64_t)get(m_cols - 1, y) << 63;
+        
+        if (m_cols & 63)
+        {
+            r[last] = (r[last] & tail) | (first << (m_cols & 63));
+            r[m_words] = 0;
+        }
+        else
+            r[m_words] = first;
+    }
+    
+    std::copy(row(m_rows - 1) - 1, row(m_rows - 1) - 1 + m_stride, row(-1) - 1);
+    std::copy(row(0) - 1, row(0) - 1 + m_stride, row(m_rows) - 1);
+}
+
+
+void GOLGrid::fromBools(const bool* cells, int cols, int rows)
+{
+    if (cols != m_cols || rows != m_rows)
+    {
+        m_cols = m_rows = 0;
+        resize(cols, rows);
+    }
+    
+    for (int y = 0; y < rows; ++y)
+    {
+        uint64_t* r = row(y);
+        const bool* src = cells + (size_t)y * cols;
+        
+        for (int w = 0; w < m_words; ++w)
+        {
+            uint64_t word = 0;
+            int n = std::min(64, cols - w * 64);
+            
+            for (int b = 0; b < n; ++b)
+            {
+                if (src[w * 64 + b])
+                    word |= (uint64_t)1 << b;
+            }
+            
+            r[w] = word;
+        }
+    }
+}
+
+void GOLGrid::toBools(bool* cells) const
+{
+    for (int y = 0; y < m_rows; ++y)
+        for (int x = 0; x < m_cols; ++x)
+            cells[(size_t)y * m_cols + x] = get(x, y);
+}
+
+
+unsigned long GOLGrid::population() const
+{
+    unsigned long count = 0;
+    
+    for (int y = 0; y < m_rows; ++y)
+    {
+        const uint64_t* r = row(y);
+        
+        for (int w = 0; w < m_words - 1; ++w)
+            count += __builtin_popcountll(r[w]);
+        
+        if (m_words > 0)
+            count += __builtin_popcountll(r[m_words-1] & tailMask());
+    }
+    
+    return count;
+}
+
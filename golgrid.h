@@ -0,0 +1,87 @@
+#ifndef GOLGRID_H
+#define GOLGRID_H
+
+
+#include <cstdint>
+#include <cstddef>
+
+
+#define GRID_BAND_ROWS  64  // rows first touched per task, see allocate()
+
+
+// Bit-packed cell storage, 64 cells per word (bit x & 63 of word x >> 6).
+//
+// Every row is surrounded by one halo word on each side and the grid by one
+// halo row on top and bottom, so row(-1), row(rows()), word -1 and word
+// words() of each row are valid addresses. The halo and the unused bits
+// behind the last column are kept dead, which lets the tick kernel read
+// the neighbourhood of every word without any bounds checks.
+//
+// The rows are zeroed band by band on the engines' thread pool, so on a NUMA
+// machine every band lands on the node of the worker that steps it later.
+
+class GOLGrid
+{
+public:
+    
+    GOLGrid();
+    GOLGrid(int cols, int rows);
+    ~GOLGrid();
+    
+    GOLGrid(const GOLGrid&) = delete;
+    GOLGrid& operator=(const GOLGrid&) = delete;
+    
+    
+    inline int columns() const { return m_cols; }
+    inline int rows() const { return m_rows; }
+    inline int words() const { return m_words; }
+    inline int stride() const { return m_stride; }
+    
+    inline uint64_t* row(int y) { return &m_data[(y+1) * m_stride + 1]; }
+    inline const uint64_t* row(int y) const { return &m_data[(y+1) * m_stride + 1]; }
+    
+    inline bool get(int x, int y) const
+    {
+        return (row(y)[x >> 6] >> (x & 63)) & 1;
+    }
+    inline void set(int x, int y, bool alive)
+    {
+        uint64_t bit = (uint64_t)1 << (x & 63);
+        uint64_t& word = row(y)[x >> 6];
+        word = alive ? (word | bit) : (word & ~bit);
+    }
+    
+    // mask of the valid bits in the last word of a row
+    inline uint64_t tailMask() const
+    {
+        return (m_cols & 63) ? (((uint64_t)1 << (m_cols & 63)) - 1) : ~(uint64_t)0;
+    }
+    
+    void resize(int cols, int rows); // keeps the overlapping region
+    void clear();
+    void swap(GOLGrid& other);
+    
+    // the halo around the board is zero (dead outside) or filled from the
+    // opposite edges (torus); wrapping also puts cell 0 of a row into the
+    // unused tail bits of its last word, where the kernel looks for it
+    void clearHalo();
+    void wrapHalo();
+    
+    void fromBools(const bool* cells, int cols, int rows);
+    void toBools(bool* cells) const;
+    
+    unsigned long population() const;
+    
+    
+private:
+    
+    static uint64_t* allocate(int stride, int rows);
+    static void zero(uint64_t* data, int stride, int rows);
+    
+    
+    int m_cols, m_rows, m_words, m_stride;
+    uint64_t* m_data;
+    
+};
+
+#endif // GOLGRID_H
@@ -0,0 +1,293 @@
+#include "golgridengine.h"
+#include "golkernels.h"
+#include "golthreadpool.h"
+#include "goltrace.h"
+
+#include <algorithm>
+
+
+GOLGridEngine::GOLGridEngine(int cols, int rows)
+ : GOLEngine(cols, rows)
+ , m_cells(cols, rows)
+ , m_buffer(cols, rows)
+ , m_wrap(false)
+ , m_population(0)
+ , m_activeTiles(0)
+ , m_hash(0)
+{
+    resizeTiles();
+}
+
+GOLGridEngine::~GOLGridEngine()
+{
+}
+
+
+void GOLGridEngine::setSize(int cols, int rows)
+{
+    // wrapped cells in the tail bits would become real ones
+    m_cells.clearHalo();
+    m_buffer.clearHalo();
+    
+    m_cells.resize(cols, rows);
+    m_buffer.resize(cols, rows);
+    
+    m_cols = cols;
+    m_rows = rows;
+    
+    m_population = m_cells.population();
+    m_bounds = m_bounds.intersected(GOLBounds(0, 0, cols - 1, rows - 1));
+    
+    resizeTiles();
+}
+
+void GOLGridEngine::clear()
+{
+    m_cells.clear();
+    m_population = 0;
+    m_bounds = GOLBounds();
+    
+    touch(0, 0, m_cols, m_rows);
+}
+
+
+void GOLGridEngine::set(int x, int y, bool alive)
+{
+    change(x, y, alive);
+    touch(x, y, 1, 1);
+}
+
+void GOLGridEngine::getRegion(int x, int y, int w, int h, bool* cells) const
+{
+    for (int i = 0; i < h; ++i)
+        for (int j = 0; j < w; ++j)
+            cells[i * w + j] = m_cells.get(x + j, y + i);
+}
+
+void GOLGridEngine::setRegion(int x, int y, int w, int h, const bool* cells)
+{
+    for (int i = 0; i < h; ++i)
+        for (int j = 0; j < w; ++j)
+            change(x + j, y + i, cells[i * w + j]);
+    
+    touch(x, y, w, h);
+}
+
+
+void GOLGridEngine::setWrap(bool wrap)
+{
+    if (wrap == m_wrap) { return; }
+    
+    m_wrap = wrap;
+    
+    if (!m_wrap)
+    {
+        m_cells.clearHalo();
+        m_buffer.clearHalo();
+    }
+    
+    std::fill(m_changed.begin(), m_changed.end(), 1);
+}
+
+void GOLGridEngine::setRule(const GOLRule& rule)
+{
+    GOLEngine::setRule(rule);
+    
+    std::fill(m_changed.begin(), m_changed.end(), 1);
+}
+
+
+void GOLGridEngine::step()
+{
+    const int tiles = m_tileCols * m_tileRows;
+    
+    if (m_wrap)
+        m_cells.wrapHalo();
+    
+    std::fill(m_active.begin(), m_active.end(), 0);
+    m_activeList.clear();
+    
+    for (int ty = 0; ty < m_tileRows; ++ty)
+    {
+        for (int tx = 0; tx < m_tileCols; ++tx)
+        {
+            if (!m_changed[ty * m_tileCols + tx]) { continue; }
+            
+            for (int dy = -1; dy <= 1; ++dy)
+            {
+                for (int dx = -1; dx <= 1; ++dx)
+                {
+                    int nx = tx + dx, ny = ty + dy;
+                    
+                    if (m_wrap)
+                    {
+                        nx = (nx + m_tileCols) % m_tileCols;
+                        ny = (ny + m_tileRows) % m_tileRows;
+                    }
+                    else if (nx < 0 || ny < 0 || nx >= m_tileCols || ny >= m_tileRows)
+                        continue;
+                    
+                    m_active[ny * m_tileCols + nx] = 1;
+                }
+            }
+        }
+    }
+    
+    for (int t = 0; t < tiles; ++t)
+    {
+        if (m_active[t])
+            m_activeList.push_back(t);
+    }
+    
+    const GOLRowKernel tickRow = GOLKernels::tickRow(m_rule);
+    const uint64_t tail = m_cells.tailMask();
+    const int words = m_cells.words();
+    const int count = (int)m_activeList.size();
+    
+    GOLThreadPool::instance().run(count, [&](int i)
+    {
+        int t = m_activeList[i];
+        GOLTraceScope scope("tile", t);
+        
+        int w0 = (t % m_tileCols) * GRID_TILE_WORDS;
+        int w1 = std::min(w0 + GRID_TILE_WORDS, words);
+        int y0 = (t / m_tileCols) * GRID_TILE_ROWS;
+        int y1 = std::min(y0 + GRID_TILE_ROWS, m_rows);
+        
+        uint64_t population = 0, diff = 0, hash = 0;
+        uint64_t columns[GRID_TILE_WORDS] = {};
+        int top = y1, bottom = y0 - 1;
+        
+        const int n = w1 - w0;
+        const uint64_t last = (w1 == words) ? tail : ~(uint64_t)0;
+        
+        for (int y = y0; y < y1; ++y)
+        {
+            const uint64_t* mid = m_cells.row(y) + w0;
+            uint64_t* out = m_buffer.row(y) + w0;
+            
+            tickRow(m_cells.row(y-1) + w0, mid, m_cells.row(y+1) + w0, out, n, m_rule);
+            out[n-1] &= last;
+            
+            for (int w = 0; w < n - 1; ++w)
+            {
+                population += __builtin_popcountll(out[w]);
+                diff |= out[w] ^ mid[w];
+            }
+            
+            // the tail of mid may hold a wrapped cell
+            population += __builtin_popcountll(out[n-1]);
+            diff |= (out[n-1] ^ mid[n-1]) & last;
+            
+            uint64_t any = 0;
+            for (int w = 0; w < n; ++w)
+            {
+                hash += hashWord(out[w], (uint64_t)y * words + w0 + w);
+                columns[w] |= out[w];
+                any |= out[w];
+            }
+            
+            if (any)
+            {
+                top = std::min(top, y);
+                bottom = y;
+            }
+        }
+        
+        GOLBounds box;
+        if (population)
+        {
+            int first = 0, last = n - 1;
+            while (!columns[first]) { ++first; }
+            while (!columns[last]) { --last; }
+            
+            box = GOLBounds(((w0 + first) << 6) + __builtin_ctzll(columns[first]), top,
+                            ((w0 + last) << 6) + 63 - __builtin_clzll(columns[last]), bottom);
+        }
+        
+        m_tilePopulation[t] = population;
+        m_tileBounds[t] = box;
+        m_tileHash[t] = hash;
+        m_changed[t] = diff != 0;
+    });
+    
+    m_population = 0;
+    m_hash = 0;
+    m_bounds = GOLBounds();
+    for (int t = 0; t < tiles; ++t)
+    {
+        m_population += m_tilePopulation[t];
+        m_hash += m_tileHash[t];
+        m_bounds.extend(m_tileBounds[t]);
+    }
+    
+    m_activeTiles = count;
+    
+    m_cells.swap(m_buffer);
+}
+
+
+bool GOLGridEngine::changedRegions(std::vector<GOLBounds>& boxes) const
+{
+    const int tileWidth = GRID_TILE_WORDS * 64;
+    
+    for (int ty = 0; ty < m_tileRows; ++ty)
+    {
+        for (int tx = 0; tx < m_tileCols; ++tx)
+        {
+            if (!m_changed[ty * m_tileCols + tx]) { continue; }
+            
+            boxes.push_back(GOLBounds(tx * tileWidth, ty * GRID_TILE_ROWS,
+                                      std::min((tx + 1) * tileWidth, m_cols) - 1,
+                                      std::min((ty + 1) * GRID_TILE_ROWS, m_rows) - 1));
+        }
+    }
+    
+    return true;
+}
+
+
+void GOLGridEngine::resizeTiles()
+{
+    m_tileCols = (m_cells.words() + GRID_TILE_WORDS - 1) / GRID_TILE_WORDS;
+    m_tileRows = (m_rows + GRID_TILE_ROWS - 1) / GRID_TILE_ROWS;
+    
+    int tiles = m_tileCols * m_tileRows;
+    
+    m_changed.assign(tiles, 1);
+    m_active.assign(tiles, 0);
+    m_tilePopulation.assign(tiles, 0);
+    m_tileHash.assign(tiles, 0);
+    m_tileBounds.assign(tiles, GOLBounds());
+    m_activeTiles = tiles;
+}
+
+// keeps the population and bounds up to date with an edit
+void GOLGridEngine::change(int x, int y, bool alive)
+{
+    if (m_cells.get(x, y) == alive) { return; }
+    
+    m_cells.set(x, y, alive);
+    
+    if (alive)
+    {
+        ++m_population;
+        m_bounds.extend(x, y);
+    }
+    else
+        --m_population;
+}
+
+// marks the tiles of a region as changed, they and their neighbours are
+// recomputed in the next step
+void GOLGridEngine::touch(int x, int y, int w, int h)
+{
+    if (w <= 0 || h <= 0) { return; }
+    
+    int tx0 = (x >> 6) / GRID_TILE_WORDS, tx1 = ((x + w - 1) >> 6) / GRID_TILE_WORDS;
+    int ty0 = y / GRID_TILE_ROWS, ty1 = (y + h - 1) / GRID_TILE_ROWS;
+    
+    for (int ty = ty0; ty <= ty1; ++ty)
+        for (int tx = tx0; tx <= tx1; ++tx)
+            m_changed[ty * m_tileCols + tx] = 1;
+}
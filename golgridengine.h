@@ -0,0 +1,88 @@
+#ifndef GOLGRIDENGINE_H
+#define GOLGRIDENGINE_H
+
+
+#define GRID_TILE_WORDS  4  // 256 columns
+#define GRID_TILE_ROWS   GRID_BAND_ROWS  // 64, one first-touch band of the grid
+
+
+#include "golengine.h"
+#include "golgrid.h"
+
+#include <vector>
+
+
+// Brute-force engine on a bit-packed GOLGrid, cells outside the board are dead
+// or, in wrap mode, the opposite edge. Either way the kernel reads the
+// neighbours across the edge from the halo of the grid and never checks bounds.
+//
+// The board is split into tiles of GRID_TILE_WORDS x GRID_TILE_ROWS and only
+// tiles that changed in the last generation, or border one that did, are
+// recomputed. A skipped tile needs no copy either: it did not change, so the
+// back buffer still holds the same content from the generation before.
+
+class GOLGridEngine : public GOLEngine
+{
+public:
+    
+    GOLGridEngine(int cols, int rows);
+    virtual ~GOLGridEngine();
+    
+    
+    virtual Type type() const override { return Grid; }
+    
+    virtual void setSize(int cols, int rows) override;
+    virtual void clear() override;
+    
+    virtual bool get(int x, int y) const override { return m_cells.get(x, y); }
+    virtual void set(int x, int y, bool alive) override;
+    
+    virtual void getRegion(int x, int y, int w, int h, bool* cells) const override;
+    virtual void setRegion(int x, int y, int w, int h, const bool* cells) override;
+    
+    virtual bool canWrap() const override { return true; }
+    virtual bool wraps() const override { return m_wrap; }
+    virtual void setWrap(bool wrap) override;
+    
+    virtual void setRule(const GOLRule& rule) override;
+    
+    virtual void step() override;
+    
+    virtual uint64_t population() const override { return m_population; }
+    virtual GOLBounds bounds() const override { return m_bounds; }
+    
+    virtual uint64_t activeTiles() const override { return m_activeTiles; }
+    virtual uint64_t tileCount() const override { return m_changed.size(); }
+    virtual bool changedRegions(std::vector<GOLBounds>& boxes) const override;
+    
+    virtual uint64_t hash() const override { return m_hash; }
+    
+    inline const GOLGrid& grid() const { return m_cells; }
+    
+    
+private:
+    
+    // Methods:
+    
+    void resizeTiles();
+    void touch(int x, int y, int w, int h);
+    void change(int x, int y, bool alive);
+    
+    
+    // Attributes:
+    
+    GOLGrid m_cells, m_buffer;
+    bool m_wrap;
+    
+    int m_tileCols, m_tileRows;
+    std::vector<uint8_t> m_changed, m_active;
+    std::vector<uint64_t> m_tilePopulation, m_tileHash;
+    std::vector<GOLBounds> m_tileBounds;
+    std::vector<int> m_activeList;
+    
+    uint64_t m_population, m_activeTiles, m_hash;
+    GOLBounds m_bounds;
+    
+};
+
+#endif // GOLGRIDENGINE_H
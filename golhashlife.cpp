@@ -0,0 +1,594 @@
+#include "golhashlife.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+#define HASHLIFE_BLOCK_SIZE  65536
+
+#define HASHLIFE_HASH_X  0x9E3779B97F4A7C15ull  // odd, so invertible modulo 2^64
+#define HASHLIFE_HASH_Y  0xC2B2AE3D27D4EB4Full
+
+
+static inline size_t nodeHash(const void* nw, const void* ne, const void* sw, const void* se)
+{
+    uint64_t h = (uint64_t)(uintptr_t)nw * 0x9E3779B97F4A7C15ull
+               + (uint64_t)(uintptr_t)ne * 0xC2B2AE3D27D4EB4Full
+               + (uint64_t)(uintptr_t)sw * 0x165667B19E3779F9ull
+               + (uint64_t)(uintptr_t)se * 0x27D4EB2F165667C5ull;
+    
+    return (size_t)(h ^ (h >> 29));
+}
+
+
+// base^(2^k) for every k, a node of level k+1 has its east and south
+// quadrants 2^k cells from the corner
+struct HashPowers
+{
+    uint64_t x[64], y[64], inverseX[64], inverseY[64];
+    
+    HashPowers()
+    {
+        uint64_t ix = inverse(HASHLIFE_HASH_X), iy = inverse(HASHLIFE_HASH_Y);
+        
+        x[0] = HASHLIFE_HASH_X;
+        y[0] = HASHLIFE_HASH_Y;
+        inverseX[0] = ix;
+        inverseY[0] = iy;
+        
+        for (int k = 1; k < 64; ++k)
+        {
+            x[k] = x[k-1] * x[k-1];
+            y[k] = y[k-1] * y[k-1];
+            inverseX[k] = inverseX[k-1] * inverseX[k-1];
+            inverseY[k] = inverseY[k-1] * inverseY[k-1];
+        }
+    }
+    
+    // Newton's iteration, each round doubles the correct low bits
+    static uint64_t inverse(uint64_t a)
+    {
+        uint64_t x = a;
+        for (int i = 0; i < 6; ++i)
+            x *= 2 - a * x;
+        
+        return x;
+    }
+};
+
+static const HashPowers s_powers;
+
+
+GOLHashLife::GOLHashLife(int cols, int rows)
+ : GOLEngine(cols, rows)
+ , m_buckets(1 << 16, NULL)
+ , m_free(NULL)
+ , m_nodeCount(0)
+{
+    std::memset(&m_dead, 0, sizeof(Node));
+    std::memset(&m_alive, 0, sizeof(Node));
+    m_alive.population = 1;
+    m_alive.hash = 1;
+    
+    m_empty.push_back(&m_dead);
+    
+    m_root = empty(3);
+    cover(0, 0, cols, rows);
+    
+    compileRule();
+}
+
+GOLHashLife::~GOLHashLife()
+{
+    for (Node* block : m_blocks)
+        delete[] block;
+}
+
+
+void GOLHashLife::setSize(int cols, int rows)
+{
+    m_cols = cols;
+    m_rows = rows;
+    
+    cover(0, 0, cols, rows);
+}
+
+void GOLHashLife::clear()
+{
+    m_root = empty(m_root->level);
+}
+
+
+bool GOLHashLife::get(int x, int y) const
+{
+    const Node* n = m_root;
+    int64_t half = (int64_t)1 << (n->level - 1);
+    int64_t nx = -half, ny = -half;
+    
+    if (x < nx || y < ny || x >= half || y >= half) { return false; }
+    
+    while (n->level > 0 && n->population > 0)
+    {
+        half = (int64_t)1 << (n->level - 1);
+        
+        bool east = x >= nx + half, south = y >= ny + half;
+        if (east) nx += half;
+        if (south) ny += half;
+        
+        n = south ? (east ? n->se : n->sw) : (east ? n->ne : n->nw);
+    }
+    
+    return n->population > 0;
+}
+
+void GOLHashLife::set(int x, int y, bool alive)
+{
+    cover(x, y, x+1, y+1);
+    
+    int64_t half = (int64_t)1 << (m_root->level - 1);
+    m_root = setCell(m_root, -half, -half, x, y, alive);
+}
+
+
+// found in the quadtree when asked, a search that only descends into nodes
+// on the board which could still move an edge of the box
+uint64_t GOLHashLife::boardPopulation() const
+{
+    int64_t half = (int64_t)1 << (m_root->level - 1);
+    
+    return count(m_root, -half, -half);
+}
+
+GOLBounds GOLHashLife::bounds() const
+{
+    GOLBounds bounds;
+    int64_t half = (int64_t)1 << (m_root->level - 1);
+    
+    bound(m_root, -half, -half, bounds);
+    
+    return bounds;
+}
+
+
+void GOLHashLife::getRegion(int x, int y, int w, int h, bool* cells) const
+{
+    std::memset(cells, false, sizeof(bool) * w * h);
+    
+    Region r = { x, y, w, h, cells, NULL };
+    int64_t half = (int64_t)1 << (m_root->level - 1);
+    
+    readRegion(m_root, -half, -half, r);
+}
+
+void GOLHashLife::setRegion(int x, int y, int w, int h, const bool* cells)
+{
+    cover(x, y, x + w, y + h);
+    
+    Region r = { x, y, w, h, NULL, cells };
+    int64_t half = (int64_t)1 << (m_root->level - 1);
+    
+    m_root = writeRegion(m_root, -half, -half, r);
+}
+
+
+void GOLHashLife::setRule(const GOLRule& rule)
+{
+    if (rule == m_rule) { return; }
+    
+    GOLEngine::setRule(rule);
+    
+    compileRule();
+    clearResults();
+}
+
+
+void GOLHashLife::step()
+{
+    if (m_nodeCount > HASHLIFE_MAX_NODES)
+        collectGarbage();
+    
+    // the pattern has to fit into the centre quarter and the root has to be
+    // big enough for the whole leap, so the successor cannot lose cells
+    while (m_root->level < m_stepExponent + 3 || !centred(m_root))
+        m_root = expand(m_root);
+    
+    m_root = successor(m_root, m_stepExponent);
+}
+
+
+// moves the root hash from its corner to the origin, so a pattern hashes the
+// same whatever the size of the root around it
+uint64_t GOLHashLife::hash() const
+{
+    const int k = m_root->level - 1;
+    
+    return hashWord(m_root->hash * s_powers.inverseX[k] * s_powers.inverseY[k], 0);
+}
+
+
+GOLHashLife::Node* GOLHashLife::join(Node* nw, Node* ne, Node* sw, Node* se)
+{
+    size_t index = nodeHash(nw, ne, sw, se) & (m_buckets.size() - 1);
+    
+    for (Node* n = m_buckets[index]; n; n = n->next)
+    {
+        if (n->nw == nw && n->ne == ne && n->sw == sw && n->se == se)
+            return n;
+    }
+    
+    Node* n = allocate();
+    n->nw = nw; n->ne = ne; n->sw = sw; n->se = se;
+    n->result = NULL;
+    n->population = nw->population + ne->population + sw->population + se->population;
+    n->level = nw->level + 1;
+    
+    const int k = nw->level;
+    n->hash = nw->hash + ne->hash * s_powers.x[k] + sw->hash * s_powers.y[k] 
+            + se->hash * s_powers.x[k] * s_powers.y[k];
+    n->marked = false;
+    
+    n->next = m_buckets[index];
+    m_buckets[index] = n;
+    
+    if (++m_nodeCount > m_buckets.size())
+        rehash();
+    
+    return n;
+}
+
+GOLHashLife::Node* GOLHashLife::empty(int level)
+{
+    while ((int)m_empty.size() <= level)
+    {
+        Node* e = m_empty.back();
+        m_empty.push_back(join(e, e, e, e));
+    }
+    
+    return m_empty[level];
+}
+
+GOLHashLife::Node* GOLHashLife::expand(Node* n)
+{
+    Node* e = empty(n->level - 1);
+    
+    return join(join(e, e, e, n->nw), join(e, e, n->ne, e),
+                join(e, n->sw, e, e), join(n->se, e, e, e));
+}
+
+bool GOLHashLife::centred(Node* n) const
+{
+    return n->level >= 3
+        && n->nw->population == n->nw->se->se->population
+        && n->ne->population == n->ne->sw->sw->population
+        && n->sw->population == n->sw->ne->ne->population
+        && n->se->population == n->se->nw->nw->population;
+}
+
+void GOLHashLife::cover(int64_t x0, int64_t y0, int64_t x1, int64_t y1)
+{
+    for (;;)
+    {
+        int64_t half = (int64_t)1 << (m_root->level - 1);
+        
+        if (x0 >= -half && y0 >= -half && x1 <= half && y1 <= half)
+            break;
+        
+        m_root = expand(m_root);
+    }
+}
+
+
+// Returns the centre of n (level k-1) advanced by 2^min(step, k-2) generations.
+// The nine overlapping level k-1 subsquares are advanced first; for a full
+// leap their results are combined and advanced once more, for a shorter one
+// only their centres are put together.
+GOLHashLife::Node* GOLHashLife::successor(Node* n, int step)
+{
+    if (n->population == 0) { return empty(n->level - 1); }
+    
+    const int leap = std::min(step, n->level - 2);
+    if (n->result && n->resultStep == leap) { return n->result; }
+    
+    Node* r;
+    
+    if (n->level == 2)
+    {
+        r = baseSuccessor(n);
+    }
+    else
+    {
+        Node *nw = n->nw, *ne = n->ne, *sw = n->sw, *se = n->se;
+        
+        Node* c1 = successor(nw, step);
+        Node* c2 = successor(join(nw->ne, ne->nw, nw->se, ne->sw), step);
+        Node* c3 = successor(ne, step);
+        Node* c4 = successor(join(nw->sw, nw->se, sw->nw, sw->ne), step);
+        Node* c5 = successor(join(nw->se, ne->sw, sw->ne, se->nw), step);
+        Node* c6 = successor(join(ne->sw, ne->se, se->nw, se->ne), step);
+        Node* c7 = successor(sw, step);
+        Node* c8 = successor(join(sw->ne, se->nw, sw->se, se->sw), step);
+        Node* c9 = successor(se, step);
+        
+        if (step < n->level - 2)
+        {
+            r = join(join(c1->se, c2->sw, c4->ne, c5->nw),
+                     join(c2->se, c3->sw, c5->ne, c6->nw),
+                     join(c4->se, c5->sw, c7->ne, c8->nw),
+                     join(c5->se, c6->sw, c8->ne, c9->nw));
+        }
+        else
+        {
+            r = join(successor(join(c1, c2, c4, c5), step),
+                     successor(join(c2, c3, c5, c6), step),
+                     successor(join(c4, c5, c7, c8), step),
+                     successor(join(c5, c6, c8, c9), step));
+        }
+    }
+    
+    n->result = r;
+    n->resultStep = (uint8_t)leap;
+    return r;
+}
+
+// one generation of the centre 2x2 cells of a 4x4 node
+GOLHashLife::Node* GOLHashLife::baseSuccessor(Node* n)
+{
+    int bits = 0; // bit y*4+x
+    
+    Node* quads[4] = { n->nw, n->ne, n->sw, n->se };
+    
+    for (int q = 0; q < 4; ++q)
+    {
+        int ox = (q & 1) * 2, oy = (q >> 1) * 2;
+        Node* cells[4] = { quads[q]->nw, quads[q]->ne, quads[q]->sw, quads[q]->se };
+        
+        for (int c = 0; c < 4; ++c)
+        {
+            if (cells[c]->population)
+                bits |= 1 << ((oy + (c >> 1)) * 4 + ox + (c & 1));
+        }
+    }
+    
+    int next = m_baseTable[bits];
+    
+    return join((next & 1) ? &m_alive : &m_dead, (next & 2) ? &m_alive : &m_dead,
+                (next & 4) ? &m_alive : &m_dead, (next & 8) ? &m_alive : &m_dead);
+}
+
+
+GOLHashLife::Node* GOLHashLife::setCell(Node* n, int64_t nx, int64_t ny,
+                                        int64_t x, int64_t y, bool alive)
+{
+    if (n->level == 0) { return alive ? &m_alive : &m_dead; }
+    
+    int64_t half = (int64_t)1 << (n->level - 1);
+    
+    bool east = x >= nx + half, south = y >= ny + half;
+    int64_t cx = east ? nx + half : nx, cy = south ? ny + half : ny;
+    
+    Node *nw = n->nw, *ne = n->ne, *sw = n->sw, *se = n->se;
+    
+    if (south)
+    {
+        if (east) se = setCell(se, cx, cy, x, y, alive);
+        else      sw = setCell(sw, cx, cy, x, y, alive);
+    }
+    else
+    {
+        if (east) ne = setCell(ne, cx, cy, x, y, alive);
+        else      nw = setCell(nw, cx, cy, x, y, alive);
+    }
+    
+    return join(nw, ne, sw, se);
+}
+
+GOLHashLife::Node* GOLHashLife::writeRegion(Node* n, int64_t nx, int64_t ny, const Region& r)
+{
+    int64_t size = (int64_t)1 << n->level;
+    
+    if (nx + size <= r.x || ny + size <= r.y || nx >= r.x + r.w || ny >= r.y + r.h)
+        return n;
+    
+    if (n->level == 0)
+        return r.constCells[(ny - r.y) * r.w + (nx - r.x)] ? &m_alive : &m_dead;
+    
+    int64_t half = size / 2;
+    
+    return join(writeRegion(n->nw, nx, ny, r), writeRegion(n->ne, nx + half, ny, r),
+                writeRegion(n->sw, nx, ny + half, r), writeRegion(n->se, nx + half, ny + half, r));
+}
+
+void GOLHashLife::readRegion(const Node* n, int64_t nx, int64_t ny, const Region& r) const
+{
+    if (n->population == 0) { return; }
+    
+    int64_t size = (int64_t)1 << n->level;
+    
+    if (nx + size <= r.x || ny + size <= r.y || nx >= r.x + r.w || ny >= r.y + r.h)
+        return;
+    
+    if (n->level == 0)
+    {
+        r.cells[(ny - r.y) * r.w + (nx - r.x)] = true;
+        return;
+    }
+    
+    int64_t half = size / 2;
+    
+    readRegion(n->nw, nx, ny, r);
+    readRegion(n->ne, nx + half, ny, r);
+    readRegion(n->sw, nx, ny + half, r);
+    readRegion(n->se, nx + half, ny + half, r);
+}
+
+void GOLHashLife::bound(const Node* n, int64_t nx, int64_t ny, GOLBounds& bounds) const
+{
+    if (n->population == 0) { return; }
+    
+    int64_t size = (int64_t)1 << n->level;
+    
+    if (nx + size <= 0 || ny + size <= 0 || nx >= m_cols || ny >= m_rows)
+        return;
+    
+    if (!bounds.empty() && nx >= bounds.x0 && ny >= bounds.y0 && 
+        nx + size - 1 <= bounds.x1 && ny + size - 1 <= bounds.y1)
+        return;
+    
+    if (n->level == 0)
+    {
+        bounds.extend((int)nx, (int)ny);
+        return;
+    }
+    
+    int64_t half = size / 2;
+    
+    bound(n->nw, nx, ny, bounds);
+    bound(n->ne, nx + half, ny, bounds);
+    bound(n->sw, nx, ny + half, bounds);
+    bound(n->se, nx + half, ny + half, bounds);
+}
+
+// nodes wholly on the board or off it are not descended into
+uint64_t GOLHashLife::count(const Node* n, int64_t nx, int64_t ny) const
+{
+    if (n->population == 0) { return 0; }
+    
+    int64_t size = (int64_t)1 << n->level;
+    
+    if (nx + size <= 0 || ny + size <= 0 || nx >= m_cols || ny >= m_rows)
+        return 0;
+    
+    if (nx >= 0 && ny >= 0 && nx + size <= m_cols && ny + size <= m_rows)
+        return n->population;
+    
+    int64_t half = size / 2;
+    
+    return count(n->nw, nx, ny) + count(n->ne, nx + half, ny) +
+           count(n->sw, nx, ny + half) + count(n->se, nx + half, ny + half);
+}
+
+
+GOLHashLife::Node* GOLHashLife::allocate()
+{
+    if (!m_free)
+    {
+        Node* block = new Node[HASHLIFE_BLOCK_SIZE];
+        m_blocks.push_back(block);
+        
+        for (int i = 0; i < HASHLIFE_BLOCK_SIZE; ++i)
+        {
+            block[i].next = m_free;
+            m_free = &block[i];
+        }
+    }
+    
+    Node* n = m_free;
+    m_free = n->next;
+    return n;
+}
+
+void GOLHashLife::rehash()
+{
+    std::vector<Node*> buckets(m_buckets.size() * 2, NULL);
+    
+    for (Node* chain : m_buckets)
+    {
+        while (chain)
+        {
+            Node* n = chain;
+            chain = n->next;
+            
+            size_t index = nodeHash(n->nw, n->ne, n->sw, n->se) & (buckets.size() - 1);
+            n->next = buckets[index];
+            buckets[index] = n;
+        }
+    }
+    
+    m_buckets.swap(buckets);
+}
+
+void GOLHashLife::mark(Node* n)
+{
+    if (n->level == 0 || n->marked) { return; }
+    
+    n->marked = true;
+    
+    mark(n->nw);
+    mark(n->ne);
+    mark(n->sw);
+    mark(n->se);
+}
+
+// Frees every node that is not part of the current universe. Memoized
+// results pointing to freed nodes are forgotten, all others are kept.
+void GOLHashLife::collectGarbage()
+{
+    mark(m_root);
+    
+    for (Node* e : m_empty)
+        mark(e);
+    
+    for (Node* chain : m_buckets)
+    {
+        for (Node* n = chain; n; n = n->next)
+        {
+            if (n->marked && n->result && !n->result->marked)
+                n->result = NULL;
+        }
+    }
+    
+    for (Node*& chain : m_buckets)
+    {
+        Node* kept = NULL;
+        
+        while (chain)
+        {
+            Node* n = chain;
+            chain = n->next;
+            
+            if (n->marked)
+            {
+                n->marked = false;
+                n->next = kept;
+                kept = n;
+            }
+            else
+            {
+                n->next = m_free;
+                m_free = n;
+                --m_nodeCount;
+            }
+        }
+        
+        chain = kept;
+    }
+}
+
+void GOLHashLife::clearResults()
+{
+    for (Node* chain : m_buckets)
+        for (Node* n = chain; n; n = n->next)
+            n->result = NULL;
+}
+
+void GOLHashLife::compileRule()
+{
+    m_baseTable.assign(1 << 16, 0);
+    
+    for (int bits = 0; bits < (1 << 16); ++bits)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            int x = 1 + (c & 1), y = 1 + (c >> 1);
+            int aliveNeighbours = 0;
+            
+            for (int ny = y-1; ny <= y+1; ++ny)
+                for (int nx = x-1; nx <= x+1; ++nx)
+                    if ((nx != x || ny != y) && (bits >> (ny * 4 + nx) & 1))
+                        ++aliveNeighbours;
+            
+            if (m_rule.next(bits >> (y * 4 + x) & 1, aliveNeighbours))
+                m_baseTable[bits] |= 1 << c;
+        }
+    }
+}
@@ -0,0 +1,122 @@
+#ifndef GOLHASHLIFE_H
+#define GOLHASHLIFE_H
+
+
+#include "golengine.h"
+
+#include <cstddef>
+#include <vector>
+
+
+#define HASHLIFE_MAX_STEP_EXPONENT  32
+#define HASHLIFE_MAX_NODES          (1 << 23)
+
+
+// HashLife (Gosper): the universe is a quadtree of canonical, immutable nodes
+// kept in a hash table, so identical regions are stored once and the
+// successor of every node is computed only once. The universe is unbounded,
+// the board is a window onto it and cells leaving it keep evolving.
+
+class GOLHashLife : public GOLEngine
+{
+public:
+    
+    GOLHashLife(int cols, int rows);
+    virtual ~GOLHashLife();
+    
+    
+    virtual Type type() const override { return HashLife; }
+    
+    virtual void setSize(int cols, int rows) override;
+    virtual void clear() override;
+    
+    virtual bool get(int x, int y) const override;
+    virtual void set(int x, int y, bool alive) override;
+    
+    virtual void getRegion(int x, int y, int w, int h, bool* cells) const override;
+    virtual void setRegion(int x, int y, int w, int h, const bool* cells) override;
+    
+    virtual int maxStepExponent() const override { return HASHLIFE_MAX_STEP_EXPONENT; }
+    
+    virtual void setRule(const GOLRule& rule) override;
+    
+    virtual void step() override;
+    
+    // of the whole universe, the bounds of the board only
+    virtual uint64_t population() const override { return m_root->population; }
+    virtual uint64_t boardPopulation() const override;
+    virtual GOLBounds bounds() const override;
+    
+    // of the whole universe, not just the board
+    virtual uint64_t hash() const override;
+    
+    inline size_t nodeCount() const { return m_nodeCount; }
+    
+    
+private:
+    
+    // A node of level k covers 2^k x 2^k cells, level 0 nodes are single cells.
+    // The result is tagged with the leap it was computed for, nodes too small
+    // for the whole leap keep theirs when the step exponent changes.
+    struct Node
+    {
+        Node *nw, *ne, *sw, *se;
+        Node* result; // centre after 2^resultStep generations, if known
+        Node* next;   // hash chain / free list
+        uint64_t population;
+        uint64_t hash; // sum of X^x Y^y over the living cells, (x, y) from the corner
+        int level;
+        uint8_t resultStep; // min(step, k-2) of the result
+        bool marked;
+    };
+    
+    struct Region
+    {
+        int64_t x, y, w, h;
+        bool* cells;
+        const bool* constCells;
+    };
+    
+    
+    // Methods:
+    
+    Node* join(Node* nw, Node* ne, Node* sw, Node* se);
+    Node* empty(int level);
+    Node* expand(Node* n);
+    Node* successor(Node* n, int step);
+    Node* baseSuccessor(Node* n);
+    
+    bool centred(Node* n) const;
+    void cover(int64_t x0, int64_t y0, int64_t x1, int64_t y1);
+    
+    Node* setCell(Node* n, int64_t nx, int64_t ny, int64_t x, int64_t y, bool alive);
+    Node* writeRegion(Node* n, int64_t nx, int64_t ny, const Region& r);
+    void readRegion(const Node* n, int64_t nx, int64_t ny, const Region& r) const;
+    void bound(const Node* n, int64_t nx, int64_t ny, GOLBounds& bounds) const;
+    uint64_t count(const Node* n, int64_t nx, int64_t ny) const;
+    
+    Node* allocate();
+    void rehash();
+    void mark(Node* n);
+    void collectGarbage();
+    void clearResults();
+    void compileRule();
+    
+    
+    // Attributes:
+    
+    Node m_dead, m_alive;
+    Node* m_root; // centred on the origin
+    
+    std::vector<Node*> m_buckets;
+    std::vector<Node*> m_blocks;
+    std::vector<Node*> m_empty;
+    Node* m_free;
+    
+    size_t m_nodeCount;
+    
+    std::vector<uint8_t> m_baseTable; // centre 2x2 of every 4x4 block (bit y*4+x) after one generation
+    
+};
+
+#endif // GOLHASHLIFE_H
@@ -0,0 +1,398 @@
+#include "golkernels.h"
+
+// every vector value is inlined, no vectors cross a function boundary
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+
+
+#if defined(__x86_64__) || defined(__i386__)
+#define GOL_X86
+#endif
+
+#define GOL_INLINE inline __attribute__((always_inline))
+
+
+// The kernels are a single template over the width of V: a plain uint64_t
+// or a GCC vector of 2, 4 or 8 of them. The functions instantiating it are
+// compiled for their instruction set with the target attribute, so the same
+// adder logic becomes SSE2, AVX2 or AVX-512 code and the dispatch can choose
+// at runtime without separate translation units or compiler flags.
+
+typedef uint64_t V1;
+typedef uint64_t V2 __attribute__((vector_size(16)));
+typedef uint64_t V4 __attribute__((vector_size(32)));
+typedef uint64_t V8 __attribute__((vector_size(64)));
+
+
+template <typename V>
+static GOL_INLINE V load(const uint64_t* p)
+{
+    V v;
+    std::memcpy(&v, p, sizeof(V));
+    return v;
+}
+
+template <typename V>
+static GOL_INLINE void store(uint64_t* p, const V& v)
+{
+    std::memcpy(p, &v, sizeof(V));
+}
+
+
+// The rule is a template parameter as well: the rules in s_compiled are
+// expanded into logic over the bit planes at compile time (Truth below),
+// RULE_RUNTIME instantiates one kernel for all other rules that evaluates
+// the truth table of its GOLRule argument instead.
+
+#define RULE_RUNTIME 0xffff
+
+// mask of the digits of a rule string, e.g. ruleMask("23") = 1<<2 | 1<<3
+static constexpr unsigned ruleMask(const char* digits)
+{
+    return *digits ? (1u << (*digits - '0')) | ruleMask(digits + 1) : 0;
+}
+
+// Shannon expansion of the truth table T over the variables x[N-1] .. x[0]
+// (bit i of T is the result for the variables forming i), constant and
+// repeated halves collapse into single operations
+template <unsigned T, int N>
+struct Truth
+{
+    enum : unsigned
+    {
+        Mask = (1u << (1u << (N - 1))) - 1,
+        Lo = T & Mask,
+        Hi = (T >> (1u << (N - 1))) & Mask
+    };
+    
+    template <typename V>
+    static GOL_INLINE V eval(const V* x)
+    {
+        const V& v = x[N - 1];
+        
+        if (Lo == Hi)           return Truth<Lo, N - 1>::eval(x);
+        if (Lo == 0)            return v & Truth<Hi, N - 1>::eval(x);
+        if (Hi == 0)            return ~v & Truth<Lo, N - 1>::eval(x);
+        if (Lo == Mask)         return ~v | Truth<Hi, N - 1>::eval(x);
+        if (Hi == Mask)         return v | Truth<Lo, N - 1>::eval(x);
+        if ((Lo ^ Hi) == Mask)  return v ^ Truth<Lo, N - 1>::eval(x);
+        
+        V lo = Truth<Lo, N - 1>::eval(x);
+        return lo ^ (v & (lo ^ Truth<Hi, N - 1>::eval(x)));
+    }
+};
+
+template <unsigned T>
+struct Truth<T, 0>
+{
+    template <typename V>
+    static GOL_INLINE V eval(const V*) { return T ? ~V() : V(); }
+};
+
+template <typename V, unsigned B, unsigned S>
+static GOL_INLINE V applyRule(const V& m, const V& s0, const V& s1, const V& s2, const V& s3)
+{
+    const V x[4] = { s0, s1, s2, m };
+    
+    V next = Truth<(B & 0xff) | ((S & 0xff) << 8), 4>::eval(x);
+    
+    // 8 neighbours look like 0 in s0..s2, s3 flips the cells where the rule
+    // tells them apart
+    const bool birth8 = (B >> 8) & 1, survive8 = ((S >> 8) ^ S) & 1;
+    
+    if (birth8 && survive8)
+        next ^= s3;
+    else if (birth8)
+        next ^= s3 & ~m;
+    else if (survive8)
+        next ^= s3 & m;
+    
+    return next;
+}
+
+// the same expansion at runtime: a full tree of multiplexers over the truth
+// table, selected by s0, s1, s2 and m. The leaves are built once per row.
+template <typename V>
+struct RuleTable
+{
+    V leaves[16], birth8, survive8;
+    
+    GOL_INLINE RuleTable(const GOLRule& rule)
+    {
+        const unsigned table = (rule.birth & 0xff) | ((rule.survive & 0xff) << 8);
+        
+        for (int i = 0; i < 16; ++i)
+            leaves[i] = ((table >> i) & 1) ? ~V() : V();
+        
+        birth8 = ((rule.birth >> 8) & 1) ? ~V() : V();
+        survive8 = (((rule.survive >> 8) ^ rule.survive) & 1) ? ~V() : V();
+    }
+};
+
+template <typename V>
+static GOL_INLINE V applyRule(const V& m, const V& s0, const V& s1, const V& s2, const V& s3,
+                              const RuleTable<V>& table)
+{
+    const V x[4] = { s0, s1, s2, m };
+    
+    V level[8];
+    
+    for (int i = 0; i < 8; ++i)
+        level[i] = table.leaves[2*i] ^ (s0 & (table.leaves[2*i] ^ table.leaves[2*i+1]));
+    
+    for (int n = 1, size = 8; n < 4; ++n, size /= 2)
+        for (int i = 0; i < size / 2; ++i)
+            level[i] = level[2*i] ^ (x[n] & (level[2*i] ^ level[2*i+1]));
+    
+    return level[0] ^ (s3 & ((table.birth8 & ~m) | (table.survive8 & m)));
+}
+
+
+// Sums the eight neighbours of all cells of V at once. The three cells of
+// the upper and lower row and the two outer cells of the middle row are
+// added up per row first (bit-sliced half/full adders), then the three row
+// sums are combined into the bit planes s0 (1), s1 (2), s2 (4) and s3 (8) of
+// the neighbour count. Conway needs no s3: 8 neighbours alias 0 and both die.
+template <typename V, unsigned B, unsigned S>
+static GOL_INLINE V lifeWord(const uint64_t* up, const uint64_t* mid,
+                             const uint64_t* down, int i, const RuleTable<V>& table)
+{
+    V u = load<V>(up + i), m = load<V>(mid + i), d = load<V>(down + i);
+    
+    V uw = (u << 1) | (load<V>(up + i - 1) >> 63);
+    V ue = (u >> 1) | (load<V>(up + i + 1) << 63);
+    V mw = (m << 1) | (load<V>(mid + i - 1) >> 63);
+    V me = (m >> 1) | (load<V>(mid + i + 1) << 63);
+    V dw = (d << 1) | (load<V>(down + i - 1) >> 63);
+    V de = (d >> 1) | (load<V>(down + i + 1) << 63);
+    
+    V ux = uw ^ ue;
+    V u0 = ux ^ u;
+    V u1 = (uw & ue) | (ux & u);
+    
+    V m0 = mw ^ me;
+    V m1 = mw & me;
+    
+    V dx = dw ^ de;
+    V d0 = dx ^ d;
+    V d1 = (dw & de) | (dx & d);
+    
+    V sx = u0 ^ m0;
+    V s0 = sx ^ d0;
+    V c0 = (u0 & m0) | (sx & d0);
+    
+    // c0, u1, m1 and d1 all weigh 2
+    V p = u1 ^ m1;
+    V q = d1 ^ c0;
+    V s1 = p ^ q;
+    V s2 = ((u1 & m1) ^ (d1 & c0)) | (p & q);
+    
+    if (B == RULE_CONWAY_BIRTH && S == RULE_CONWAY_SURVIVE)
+        return s1 & ~s2 & (s0 | m);
+    
+    V s3 = u1 & m1 & d1 & c0;
+    
+    if (B == RULE_RUNTIME)
+        return applyRule<V>(m, s0, s1, s2, s3, table);
+    
+    return applyRule<V, B, S>(m, s0, s1, s2, s3);
+}
+
+template <typename V> struct Half     { typedef V1 Type; };
+template <>           struct Half<V4> { typedef V2 Type; };
+template <>           struct Half<V8> { typedef V4 Type; };
+
+template <typename V, unsigned B, unsigned S>
+static GOL_INLINE unsigned long lifeRow(const uint64_t* up, const uint64_t* mid,
+                                        const uint64_t* down, uint64_t* out, int words,
+                                        const GOLRule& rule)
+{
+    const int n = sizeof(V) / sizeof(uint64_t);
+    const RuleTable<V> table(rule);
+    
+    unsigned long count = 0;
+    int i = 0;
+    
+    for (; i + n <= words; i += n)
+    {
+        store<V>(out + i, lifeWord<V, B, S>(up, mid, down, i, table));
+        
+        for (int j = 0; j < n; ++j)
+            count += __builtin_popcountll(mid[i+j]);
+    }
+    
+    if (n == 1 || i == words)
+        return count;
+    
+    // the grid engine ticks tiles a few words wide, so the rest goes through
+    // the next narrower vector instead of falling back to single words
+    return count + lifeRow<typename Half<V>::Type, B, S>(up + i, mid + i, down + i, out + i,
+                                                         words - i, rule);
+}
+
+
+template <unsigned B, unsigned S>
+static unsigned long lifeRowScalar(const uint64_t* up, const uint64_t* mid,
+                                   const uint64_t* down, uint64_t* out, int words,
+                                   const GOLRule& rule)
+{
+    return lifeRow<V1, B, S>(up, mid, down, out, words, rule);
+}
+
+#ifdef GOL_X86
+
+template <unsigned B, unsigned S>
+__attribute__((target("sse2")))
+static unsigned long lifeRowSSE2(const uint64_t* up, const uint64_t* mid,
+                                 const uint64_t* down, uint64_t* out, int words,
+                                 const GOLRule& rule)
+{
+    return lifeRow<V2, B, S>(up, mid, down, out, words, rule);
+}
+
+template <unsigned B, unsigned S>
+__attribute__((target("avx2,popcnt")))
+static unsigned long lifeRowAVX2(const uint64_t* up, const uint64_t* mid,
+                                 const uint64_t* down, uint64_t* out, int words,
+                                 const GOLRule& rule)
+{
+    return lifeRow<V4, B, S>(up, mid, down, out, words, rule);
+}
+
+template <unsigned B, unsigned S>
+__attribute__((target("avx512f,popcnt")))
+static unsigned long lifeRowAVX512(const uint64_t* up, const uint64_t* mid,
+                                   const uint64_t* down, uint64_t* out, int words,
+                                   const GOLRule& rule)
+{
+    return lifeRow<V8, B, S>(up, mid, down, out, words, rule);
+}
+
+#define RULE_KERNELS(b, s) { b, s, { lifeRowScalar<b, s>, lifeRowSSE2<b, s>, \
+                                     lifeRowAVX2<b, s>, lifeRowAVX512<b, s> } }
+#else
+#define RULE_KERNELS(b, s) { b, s, { lifeRowScalar<b, s>, lifeRowScalar<b, s>, \
+                                     lifeRowScalar<b, s>, lifeRowScalar<b, s> } }
+#endif
+
+#define RULE_KERNELS_BS(b, s) RULE_KERNELS(ruleMask(b), ruleMask(s))
+
+
+struct RuleKernels
+{
+    unsigned birth, survive;
+    GOLRowKernel kernels[GOLKernels::KernelCount];
+};
+
+static const RuleKernels s_compiled[] =
+{
+    RULE_KERNELS(RULE_CONWAY_BIRTH, RULE_CONWAY_SURVIVE),
+    RULE_KERNELS_BS("36", "23"),         // HighLife
+    RULE_KERNELS_BS("3678", "34678"),    // Day & Night
+    RULE_KERNELS_BS("2", ""),            // Seeds
+    RULE_KERNELS_BS("3", "012345678"),   // Life without Death
+    RULE_KERNELS_BS("3", "12345"),       // Maze
+    RULE_KERNELS_BS("36", "125"),        // 2x2
+    RULE_KERNELS_BS("1357", "1357"),     // Replicator
+    RULE_KERNELS_BS("35678", "5678"),    // Diamoeba
+    RULE_KERNELS_BS("368", "245"),       // Morley
+    RULE_KERNELS_BS("4678", "35678")     // Anneal
+};
+
+static const RuleKernels s_runtime = RULE_KERNELS(RULE_RUNTIME, RULE_RUNTIME);
+
+
+static const char* s_kernelNames[GOLKernels::KernelCount] =
+{
+    "scalar", "sse2", "avx2", "avx512"
+};
+
+static const RuleKernels* ruleKernels(const GOLRule& rule)
+{
+    for (const RuleKernels& compiled : s_compiled)
+    {
+        if (compiled.birth == rule.birth && compiled.survive == rule.survive)
+            return &compiled;
+    }
+    
+    return nullptr;
+}
+
+
+GOLKernels::Kernel GOLKernels::s_active = GOLKernels::startupKernel();
+
+
+bool GOLKernels::supported(Kernel kernel)
+{
+#ifdef GOL_X86
+    __builtin_cpu_init();
+    
+    switch (kernel)
+    {
+        case Scalar: return true;
+        case SSE2:   return __builtin_cpu_supports("sse2");
+        case AVX2:   return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+        case AVX512: return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("popcnt");
+        default:     return false;
+    }
+#else
+    return kernel == Scalar;
+#endif
+}
+
+const char* GOLKernels::name(Kernel kernel)
+{
+    return (kernel >= 0 && kernel < KernelCount) ? s_kernelNames[kernel] : "";
+}
+
+GOLKernels::Kernel GOLKernels::best()
+{
+    for (int k = KernelCount-1; k > Scalar; --k)
+    {
+        if (supported((Kernel)k))
+            return (Kernel)k;
+    }
+    
+    return Scalar;
+}
+
+bool GOLKernels::setActive(Kernel kernel)
+{
+    if (!supported(kernel)) { return false; }
+    
+    s_active = kernel;
+    
+    return true;
+}
+
+GOLKernels::Kernel GOLKernels::startupKernel()
+{
+    const char* env = std::getenv("GOL_KERNEL");
+    
+    if (env)
+    {
+        for (int k = 0; k < KernelCount; ++k)
+        {
+            if (strcasecmp(env, s_kernelNames[k]) == 0 && supported((Kernel)k))
+                return (Kernel)k;
+        }
+    }
+    
+    return best();
+}
+
+
+GOLRowKernel GOLKernels::tickRow(const GOLRule& rule)
+{
+    const RuleKernels* compiled = ruleKernels(rule);
+    
+    return (compiled ? compiled : &s_runtime)->kernels[s_active];
+}
+
+bool GOLKernels::isCompiled(const GOLRule& rule)
+{
+    return ruleKernels(rule) != nullptr;
+}
@@ -0,0 +1,50 @@
+#ifndef GOLKERNELS_H
+#define GOLKERNELS_H
+
+
+#include "golrule.h"
+
+#include <cstdint>
+
+
+// Computes the next generation of 'words' words of a GOLGrid row into 'out'.
+// up, mid and down point to the first word of the rows above, at and below,
+// the kernels also read the word in front of and behind that range.
+// Returns the population of mid.
+typedef unsigned long (*GOLRowKernel)(const uint64_t* up, const uint64_t* mid,
+                                       const uint64_t* down, uint64_t* out, int words,
+                                       const GOLRule& rule);
+
+
+class GOLKernels
+{
+public:
+    
+    enum Kernel { Scalar, SSE2, AVX2, AVX512, KernelCount };
+    
+    
+    static bool supported(Kernel kernel);
+    static const char* name(Kernel kernel);
+    
+    static Kernel best();
+    
+    // the kernel picked at startup, can be overridden with the
+    // GOL_KERNEL environment variable (e.g. GOL_KERNEL=scalar)
+    static inline Kernel active() { return s_active; }
+    static bool setActive(Kernel kernel);
+    
+    // kernel for a rule on the active instruction set, common rules have
+    // kernels of their own, all others share one reading the rule at runtime
+    static GOLRowKernel tickRow(const GOLRule& rule);
+    static bool isCompiled(const GOLRule& rule);
+    
+    
+private:
+    
+    static Kernel s_active;
+    
+    static Kernel startupKernel();
+    
+};
+
+#endif // GOLKERNELS_H
@@ -0,0 +1,289 @@
+#include "golmultistateengine.h"
+#include "golthreadpool.h"
+#include "goltrace.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+
+GOLMultiStateEngine::GOLMultiStateEngine(int cols, int rows)
+ : GOLEngine(cols, rows)
+ , m_cells((size_t)cols * rows, 0)
+ , m_buffer((size_t)cols * rows, 0)
+ , m_wrap(false)
+ , m_population(0)
+ , m_hash(0)
+{
+    setRule(m_rule);
+}
+
+GOLMultiStateEngine::~GOLMultiStateEngine()
+{
+}
+
+
+void GOLMultiStateEngine::setSize(int cols, int rows)
+{
+    std::vector<uint8_t> cells((size_t)cols * rows, 0);
+    
+    for (int y = 0; y < std::min(rows, m_rows); ++y)
+        std::copy(&m_cells[(size_t)y * m_cols], &m_cells[(size_t)y * m_cols] + std::min(cols, m_cols),
+                  &cells[(size_t)y * cols]);
+    
+    m_cells.swap(cells);
+    m_buffer.assign((size_t)cols * rows, 0);
+    
+    m_cols = cols;
+    m_rows = rows;
+    
+    m_population = std::count(m_cells.begin(), m_cells.end(), 1);
+    m_bounds = m_bounds.intersected(GOLBounds(0, 0, cols - 1, rows - 1));
+}
+
+void GOLMultiStateEngine::clear()
+{
+    std::fill(m_cells.begin(), m_cells.end(), 0);
+    m_population = 0;
+    m_hash = 0;
+    m_bounds = GOLBounds();
+}
+
+
+void GOLMultiStateEngine::getRegion(int x, int y, int w, int h, bool* cells) const
+{
+    for (int i = 0; i < h; ++i)
+        for (int j = 0; j < w; ++j)
+            cells[i * w + j] = m_cells[(size_t)(y + i) * m_cols + x + j] == 1;
+}
+
+void GOLMultiStateEngine::setRegion(int x, int y, int w, int h, const bool* cells)
+{
+    for (int i = 0; i < h; ++i)
+        for (int j = 0; j < w; ++j)
+            change(x + j, y + i, cells[i * w + j]);
+}
+
+void GOLMultiStateEngine::getStates(int x, int y, int w, int h, uint8_t* states) const
+{
+    for (int i = 0; i < h; ++i)
+        std::copy(&m_cells[(size_t)(y + i) * m_cols + x], &m_cells[(size_t)(y + i) * m_cols + x] + w,
+                  states + i * w);
+}
+
+void GOLMultiStateEngine::setStates(int x, int y, int w, int h, const uint8_t* states)
+{
+    for (int i = 0; i < h; ++i)
+        for (int j = 0; j < w; ++j)
+            change(x + j, y + i, states[i * w + j] < m_rule.states ? states[i * w + j] : 0);
+}
+
+
+void GOLMultiStateEngine::setRule(const GOLRule& rule)
+{
+    GOLEngine::setRule(rule);
+    
+    int counts = rule.neighbourhood() + 1;
+    
+    m_birth.assign(counts, 0);
+    m_survive.assign(counts, 0);
+    
+    for (int n = 0; n < counts; ++n)
+    {
+        m_birth[n] = rule.next(false, n);
+        m_survive[n] = rule.next(true, n);
+    }
+    
+    // dying states the new rule does not have are dead
+    for (uint8_t& cell : m_cells)
+    {
+        if (cell >= rule.states)
+            cell = 0;
+    }
+}
+
+
+void GOLMultiStateEngine::step()
+{
+    if (m_cols == 0 || m_rows == 0) { return; }
+    
+    buildSums();
+    
+    const int tileCols = (m_cols + MULTI_TILE_COLS - 1) / MULTI_TILE_COLS;
+    const int tileRows = (m_rows + MULTI_TILE_ROWS - 1) / MULTI_TILE_ROWS;
+    
+    m_tilePopulation.resize((size_t)tileCols * tileRows);
+    m_tileHash.resize((size_t)tileCols * tileRows);
+    m_tileBounds.resize((size_t)tileCols * tileRows);
+    
+    GOLThreadPool::instance().run(tileCols * tileRows, [&](int t)
+    {
+        GOLTraceScope scope("tile", t);
+        
+        int x0 = (t % tileCols) * MULTI_TILE_COLS;
+        int y0 = (t / tileCols) * MULTI_TILE_ROWS;
+        
+        m_tilePopulation[t] = stepTile(x0, y0, std::min(x0 + MULTI_TILE_COLS, m_cols), 
+                                       std::min(y0 + MULTI_TILE_ROWS, m_rows), m_tileHash[t], m_tileBounds[t]);
+    });
+    
+    m_cells.swap(m_buffer);
+    
+    m_population = 0;
+    m_hash = 0;
+    m_bounds = GOLBounds();
+    for (size_t t = 0; t < m_tilePopulation.size(); ++t)
+    {
+        m_population += m_tilePopulation[t];
+        m_hash += m_tileHash[t];
+        m_bounds.extend(m_tileBounds[t]);
+    }
+}
+
+// computes [x0, x1) x [y0, y1) into m_buffer, returns its population, hash
+// and bounds (x0 is a multiple of 8)
+uint64_t GOLMultiStateEngine::stepTile(int x0, int y0, int x1, int y1, uint64_t& hash, GOLBounds& bounds)
+{
+    const int r = m_rule.radius;
+    const int states = m_rule.states;
+    const int width = m_cols + 2 * r + 1;
+    const int32_t* sums = m_sums.data();
+    
+    uint64_t population = 0;
+    hash = 0;
+    bounds = GOLBounds();
+    
+    for (int y = y0; y < y1; ++y)
+    {
+        const uint8_t* cells = &m_cells[(size_t)y * m_cols];
+        uint8_t* out = &m_buffer[(size_t)y * m_cols];
+        
+        // padded row y + r is sums row y + r + 1, the rows and columns of the
+        // neighbourhood of (x, y) run from x / y to x / y + 2r in padded
+        // coordinates
+        const int32_t* top = sums + (size_t)y * width;
+        const int32_t* bottom = sums + (size_t)(y + 2 * r + 1) * width;
+        
+        for (int x = x0; x < x1; ++x)
+        {
+            int n;
+            
+            if (!m_rule.vonNeumann)
+            {
+                n = bottom[x + 2*r + 1] - bottom[x] - top[x + 2*r + 1] + top[x];
+            }
+            else
+            {
+                n = 0;
+                
+                for (int dy = -r; dy <= r; ++dy)
+                {
+                    int span = r - std::abs(dy);
+                    const int32_t* above = sums + (size_t)(y + r + dy) * width;
+                    const int32_t* below = above + width;
+                    
+                    int left = x + r - span, right = x + r + span + 1;
+                    n += below[right] - below[left] - above[right] + above[left];
+                }
+            }
+            
+            uint8_t state = cells[x];
+            n -= state == 1;
+            
+            if (state == 0)
+                state = m_birth[n];
+            else if (state == 1)
+                state = m_survive[n] ? 1 : (states > 2 ? 2 : 0);
+            else
+                state = (state + 1 == states) ? 0 : state + 1;
+            
+            out[x] = state;
+            population += state == 1;
+        }
+        
+        int first = x1, last = x0 - 1;
+        
+        for (int x = x0; x < x1; x += 8)
+        {
+            uint64_t word = 0;
+            std::memcpy(&word, out + x, std::min(8, x1 - x));
+            hash += hashWord(word, (uint64_t)y * m_cols + x);
+            
+            // little endian, the first state is the lowest byte
+            if (word)
+            {
+                first = std::min(first, x + __builtin_ctzll(word) / 8);
+                last = x + 7 - __builtin_clzll(word) / 8;
+            }
+        }
+        
+        bounds.extend(GOLBounds(first, y, last, y));
+    }
+    
+    return population;
+}
+
+
+// summed-area table of the living cells, padded by the radius
+void GOLMultiStateEngine::buildSums()
+{
+    const int r = m_rule.radius;
+    const int width = m_cols + 2 * r + 1;
+    const int height = m_rows + 2 * r + 1;
+    
+    m_sums.resize((size_t)width * height);
+    std::fill(m_sums.begin(), m_sums.begin() + width, 0);
+    
+    // running sums along the rows first ...
+    GOLThreadPool::instance().run(height - 1, [&](int i)
+    {
+        GOLTraceScope scope("sum row", i + 1);
+        
+        int py = i + 1;
+        int32_t* row = &m_sums[(size_t)py * width];
+        int y = i - r;
+        
+        if (m_wrap)
+            y = ((y % m_rows) + m_rows) % m_rows;
+        
+        row[0] = 0;
+        
+        if (y < 0 || y >= m_rows)
+        {
+            std::fill(row + 1, row + width, 0);
+            return;
+        }
+        
+        const uint8_t* cells = &m_cells[(size_t)y * m_cols];
+        int32_t sum = 0;
+        
+        for (int px = 1; px < width; ++px)
+        {
+            int x = px - 1 - r;
+            
+            if (m_wrap)
+                x = ((x % m_cols) + m_cols) % m_cols;
+            
+            sum += (x >= 0 && x < m_cols && cells[x] == 1);
+            row[px] = sum;
+        }
+    });
+    
+    // ... then down the columns, a strip of them per task
+    GOLThreadPool::instance().run((width + MULTI_TILE_COLS - 1) / MULTI_TILE_COLS, [&](int strip)
+    {
+        GOLTraceScope scope("sum strip", strip);
+        
+        int x0 = strip * MULTI_TILE_COLS;
+        int x1 = std::min(x0 + MULTI_TILE_COLS, width);
+        
+        for (int py = 1; py < height; ++py)
+        {
+            int32_t* row = &m_sums[(size_t)py * width];
+            const int32_t* above = row - width;
+            
+            for (int px = x0; px < x1; ++px)
+                row[px] += above[px];
+        }
+    });
+}
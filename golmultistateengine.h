@@ -0,0 +1,93 @@
+#ifndef GOLMULTISTATEENGINE_H
+#define GOLMULTISTATEENGINE_H
+
+
+#include "golengine.h"
+
+#include <vector>
+
+
+#define MULTI_TILE_COLS  256
+#define MULTI_TILE_ROWS   32
+
+
+// One byte per cell for every rule GOLRule can describe, including the
+// Generations and Larger than Life families the bit-packed engines cannot
+// run. Neighbours are counted from a summed-area table of the living cells,
+// so a square neighbourhood costs four lookups whatever its radius and a
+// diamond one 4 * (2 * radius + 1). The table is padded by the radius with
+// dead cells or, in wrap mode, with the opposite edges.
+
+class GOLMultiStateEngine : public GOLEngine
+{
+public:
+    
+    GOLMultiStateEngine(int cols, int rows);
+    virtual ~GOLMultiStateEngine();
+    
+    
+    virtual Type type() const override { return MultiState; }
+    
+    virtual void setSize(int cols, int rows) override;
+    virtual void clear() override;
+    
+    virtual bool get(int x, int y) const override { return m_cells[(size_t)y * m_cols + x] == 1; }
+    virtual void set(int x, int y, bool alive) override { change(x, y, alive); }
+    
+    virtual void getRegion(int x, int y, int w, int h, bool* cells) const override;
+    virtual void setRegion(int x, int y, int w, int h, const bool* cells) override;
+    virtual void getStates(int x, int y, int w, int h, uint8_t* states) const override;
+    virtual void setStates(int x, int y, int w, int h, const uint8_t* states) override;
+    
+    virtual bool canWrap() const override { return true; }
+    virtual bool wraps() const override { return m_wrap; }
+    virtual void setWrap(bool wrap) override { m_wrap = wrap; }
+    
+    virtual bool supportsRule(const GOLRule&) const override { return true; }
+    virtual void setRule(const GOLRule& rule) override;
+    
+    virtual void step() override;
+    
+    // cells in state 1, dying cells do not count but are within the bounds
+    virtual uint64_t population() const override { return m_population; }
+    virtual GOLBounds bounds() const override { return m_bounds; }
+    
+    virtual uint64_t hash() const override { return m_hash; }
+    
+    
+private:
+    
+    // Methods:
+    
+    void buildSums();
+    uint64_t stepTile(int x0, int y0, int x1, int y1, uint64_t& hash, GOLBounds& bounds);
+    
+    // keeps the population and bounds up to date with an edit
+    inline void change(int x, int y, uint8_t state)
+    {
+        uint8_t& cell = m_cells[(size_t)y * m_cols + x];
+        
+        m_population += (state == 1) - (cell == 1);
+        if (state)
+            m_bounds.extend(x, y);
+        
+        cell = state;
+    }
+    
+    
+    // Attributes:
+    
+    std::vector<uint8_t> m_cells, m_buffer;
+    std::vector<int32_t> m_sums;   // (rows + 2r + 1) x (cols + 2r + 1), first row and column 0
+    std::vector<uint8_t> m_birth, m_survive; // by neighbour count
+    
+    std::vector<uint64_t> m_tilePopulation, m_tileHash;
+    std::vector<GOLBounds> m_tileBounds;
+    
+    bool m_wrap;
+    uint64_t m_population, m_hash;
+    GOLBounds m_bounds;
+    
+};
+
+#endif // GOLMULTISTATEENGINE_H
@@ -0,0 +1,119 @@
+#include "golperiod.h"
+
+
+static const char* s_stateNames[] = { "Running", "Extinct", "Still life", "Oscillating" };
+
+
+GOLPeriodDetector::GOLPeriodDetector()
+{
+    clear();
+}
+
+
+void GOLPeriodDetector::clear()
+{
+    m_savedHash = 0;
+    m_savedGeneration = 0;
+    m_steps = 0;
+    m_power = 1;
+    m_generation = 0;
+    m_saved = false;
+    m_leaped = false;
+    
+    m_resolving = false;
+    m_multiple = 0;
+    
+    m_state = Running;
+    m_period = 0;
+}
+
+GOLPeriodDetector::State GOLPeriodDetector::update(uint64_t hash, uint64_t population, uint64_t generation)
+{
+    if (population == 0)
+    {
+        m_state = Extinct;
+        m_period = 1;
+        
+        return m_state;
+    }
+    
+    // a settled board stays settled until it is edited, which clears
+    if (m_state != Running && m_state != Extinct) { return m_state; }
+    
+    m_state = Running;
+    m_period = 0;
+    
+    const bool single = m_saved && generation == m_generation + 1;
+    m_generation = generation;
+    
+    if (m_resolving)
+    {
+        // the board is periodic from the saved generation on, so counting
+        // may start over from any later one
+        if (!single)
+        {
+            m_savedHash = hash;
+            m_savedGeneration = generation;
+            
+            return m_state;
+        }
+        
+        if (hash == m_savedHash)
+        {
+            m_resolving = false;
+            m_period = generation - m_savedGeneration;
+            m_state = (m_period == 1) ? StillLife : Oscillating;
+            
+            return m_state;
+        }
+        
+        if (generation - m_savedGeneration < m_multiple) { return m_state; }
+        
+        // not back after the whole distance, the hashes collided
+        m_resolving = false;
+        m_saved = false;
+        m_steps = 0;
+        m_power = 1;
+    }
+    
+    if (m_saved && !single)
+        m_leaped = true;
+    
+    if (m_saved && hash == m_savedHash && generation > m_savedGeneration)
+    {
+        // single generations find the first repeat, which is the period
+        if (!m_leaped)
+        {
+            m_period = generation - m_savedGeneration;
+            m_state = (m_period == 1) ? StillLife : Oscillating;
+            
+            return m_state;
+        }
+        
+        m_resolving = true;
+        m_multiple = generation - m_savedGeneration;
+        m_savedGeneration = generation;
+        
+        return m_state;
+    }
+    
+    if (!m_saved || ++m_steps == m_power)
+    {
+        m_savedHash = hash;
+        m_savedGeneration = generation;
+        m_saved = true;
+        m_leaped = false;
+        
+        if (m_steps == m_power)
+            m_power *= 2;
+        m_steps = 0;
+    }
+    
+    return m_state;
+}
+
+
+const char* GOLPeriodDetector::stateName(State state)
+{
+    return s_stateNames[state];
+}
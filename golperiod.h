@@ -0,0 +1,60 @@
+#ifndef GOLPERIOD_H
+#define GOLPERIOD_H
+
+
+#include <cstdint>
+
+
+// Spots a board that has settled from the hashes of its generations: a hash
+// seen again means the generation repeats, with the distance between the two
+// as the period. Brent's cycle detection keeps a single earlier hash and moves
+// it forward whenever the distance reaches a power of two, so an update is one
+// comparison and a period P shows up within about 2P generations of the
+// board settling.
+//
+// Updates may be generations apart (HashLife leaps). A repeat seen across
+// such a leap only says that the period divides the distance, so the
+// detector then asks for single generations (resolving()) until the board
+// comes back to where it was: a still life after one leap of 2^k generations
+// is found to have period 1, a blinker period 2.
+
+class GOLPeriodDetector
+{
+public:
+    
+    enum State { Running, Extinct, StillLife, Oscillating };
+    
+    
+    GOLPeriodDetector();
+    
+    
+    // forgets the history, after the board was edited or replaced
+    void clear();
+    
+    State update(uint64_t hash, uint64_t population, uint64_t generation);
+    
+    inline State state() const { return m_state; }
+    inline uint64_t period() const { return m_period; } // generations, 0 while running
+    
+    // the board repeats, the next updates should be one generation apart
+    inline bool resolving() const { return m_resolving; }
+    
+    static const char* stateName(State state);
+    
+    
+private:
+    
+    uint64_t m_savedHash, m_savedGeneration;
+    uint64_t m_steps, m_power; // updates since the hash was saved, when to save again
+    uint64_t m_generation;     // of the last update
+    bool m_saved, m_leaped;    // leaped: an update since the saved one was more than one generation
+    
+    bool m_resolving;
+    uint64_t m_multiple; // of the period while resolving
+    
+    State m_state;
+    uint64_t m_period;
+    
+};
+
+#endif // GOLPERIOD_H
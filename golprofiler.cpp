@@ -0,0 +1,70 @@
+#include "golprofiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+
+static const char* s_metricNames[GOLProfiler::MetricCount] = 
+    { "Step", "Lock wait", "Paint", "Tick interval", "Signal latency", "Render" };
+
+
+GOLProfiler::GOLProfiler()
+{
+    m_enabled.store(false);
+    clear();
+}
+
+
+int64_t GOLProfiler::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+GOLProfiler::Summary GOLProfiler::summary(Metric metric) const
+{
+    Summary s = { m_count[metric].load(std::memory_order_relaxed), 0.0, 0.0, 0.0, 0.0, 0.0 };
+    
+    const size_t n = (size_t)std::min<uint64_t>(s.count, PROFILER_SAMPLES);
+    if (n == 0) { return s; }
+    
+    std::vector<int64_t> samples(n);
+    for (size_t i = 0; i < n; ++i)
+        samples[i] = m_samples[metric][i].load(std::memory_order_relaxed);
+    
+    std::sort(samples.begin(), samples.end());
+    
+    double sum = 0.0;
+    for (int64_t sample : samples)
+        sum += sample;
+    
+    // nearest rank
+    auto percentile = [&](int p) { return samples[std::min(n - 1, (n * p + 99) / 100 - 1)] / 1e6; };
+    
+    s.mean = sum / n / 1e6;
+    s.p50 = percentile(50);
+    s.p90 = percentile(90);
+    s.p99 = percentile(99);
+    s.max = samples.back() / 1e6;
+    
+    return s;
+}
+
+void GOLProfiler::clear()
+{
+    for (int m = 0; m < MetricCount; ++m)
+    {
+        m_count[m].store(0);
+        
+        for (int i = 0; i < PROFILER_SAMPLES; ++i)
+            m_samples[m][i].store(0);
+    }
+}
+
+
+const char* GOLProfiler::metricName(Metric metric)
+{
+    return metric < MetricCount ? s_metricNames[metric] : "";
+}
@@ -0,0 +1,73 @@
+#ifndef GOLPROFILER_H
+#define GOLPROFILER_H
+
+
+#define PROFILER_SAMPLES  1024  // per metric, the statistics are over the latest ones
+
+
+#include <atomic>
+#include <cstdint>
+
+
+// Timings of the hot paths, recorded from any thread without a lock: every
+// metric is a ring of the latest PROFILER_SAMPLES durations. Reading the
+// statistics copies a ring, a sample overwritten meanwhile only means a
+// slightly newer one is counted instead. Off until enabled, a disabled
+// profiler records nothing.
+
+class GOLProfiler
+{
+public:
+    
+    enum Metric
+    {
+        Step,          // engine step of a tick
+        LockWait,      // for m_cellsMutex, 0 if it was free
+        Paint,         // drawBackground()
+        TickInterval,  // start to start of two ticks in a row, the achieved FPS
+        SignalLatency, // frame rendered until the GUI thread got the signal
+        Render,        // pixels of a frame on the render thread
+        MetricCount
+    };
+    
+    // milliseconds
+    struct Summary
+    {
+        uint64_t count; // ever recorded
+        double mean, p50, p90, p99, max;
+    };
+    
+    
+    GOLProfiler();
+    
+    
+    // nanoseconds of a steady clock, the same on every thread
+    static int64_t now();
+    
+    inline bool enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+    inline void setEnabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+    
+    inline void record(Metric metric, int64_t nsecs)
+    {
+        if (!enabled()) { return; }
+        
+        uint64_t i = m_count[metric].fetch_add(1, std::memory_order_relaxed);
+        m_samples[metric][i % PROFILER_SAMPLES].store(nsecs, std::memory_order_relaxed);
+    }
+    
+    Summary summary(Metric metric) const;
+    void clear();
+    
+    static const char* metricName(Metric metric);
+    
+    
+private:
+    
+    std::atomic<bool> m_enabled;
+    
+    std::atomic<int64_t> m_samples[MetricCount][PROFILER_SAMPLES];
+    std::atomic<uint64_t> m_count[MetricCount];
+    
+};
+
+#endif // GOLPROFILER_H
@@ -0,0 +1,49 @@
+#include "golrenderthread.h"
+#include "golscene.h"
+#include "goltrace.h"
+
+
+GOLRenderThread::GOLRenderThread(GOLScene* scene, QObject *parent)
+  : QThread(parent)
+  , m_woken(false)
+  , m_scene(scene)
+{
+    m_run.store(true);
+}
+
+GOLRenderThread::~GOLRenderThread()
+{
+    
+}
+
+
+void GOLRenderThread::run()
+{
+    GOLTrace::setThreadName("render");
+    
+    std::unique_lock<std::mutex> lock(m_wakeMutex);
+    
+    while (m_run.load())
+    {
+        m_wake.wait(lock, [this] { return m_woken; });
+        m_woken = false;
+        
+        if (!m_run.load()) { break; }
+        
+        // frames published meanwhile are taken by this or the next one
+        lock.unlock();
+        m_scene->renderFrame();
+        lock.lock();
+    }
+}
+
+
+void GOLRenderThread::wake()
+{
+    {
+        std::lock_guard<std::mutex> guard(m_wakeMutex);
+        m_woken = true;
+    }
+    
+    m_wake.notify_one();
+}
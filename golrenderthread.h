@@ -0,0 +1,50 @@
+#ifndef GOLRENDERTHREAD_H
+#define GOLRENDERTHREAD_H
+
+
+#include <QThread>
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+
+
+class GOLScene;
+
+
+// Turns the generations the simulation publishes into pixels, between the
+// simulation thread and the GUI thread. Sleeps until the simulation wakes it
+// with a new frame, the GUI thread only presents what it renders.
+
+class GOLRenderThread : public QThread
+{
+    Q_OBJECT
+    
+public:
+    explicit GOLRenderThread(GOLScene* scene, QObject *parent = nullptr);
+    virtual ~GOLRenderThread();
+    
+    
+    inline void setRun(bool run) { m_run.store(run); wake(); }
+    
+    void wake(); // a frame was published
+    
+    
+protected:
+    
+    virtual void run() override;
+    
+    
+private:
+    
+    std::atomic<bool> m_run;
+    
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    bool m_woken;
+    
+    GOLScene* m_scene;
+    
+};
+
+#endif // GOLRENDERTHREAD_H
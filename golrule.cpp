@@ -0,0 +1,244 @@
+#include "golrule.h"
+
+#include <algorithm>
+#include <cctype>
+#include <vector>
+
+
+// digits 0-8 of text[i..] into mask, stops at the first other character
+static size_t parseDigits(const std::string& text, size_t i, uint16_t& mask)
+{
+    for (; i < text.size() && text[i] >= '0' && text[i] <= '8'; ++i)
+        mask |= 1 << (text[i] - '0');
+    
+    return i;
+}
+
+// decimal number at text[i..], advances i past it
+static bool parseNumber(const std::string& text, size_t& i, int& value)
+{
+    size_t start = i;
+    
+    for (value = 0; i < text.size() && std::isdigit((unsigned char)text[i]) && i - start < 6; ++i)
+        value = value * 10 + (text[i] - '0');
+    
+    return i > start;
+}
+
+static std::vector<std::string> split(const std::string& text, char separator)
+{
+    std::vector<std::string> parts(1);
+    
+    for (char c : text)
+    {
+        if (c == separator)
+            parts.push_back(std::string());
+        else
+            parts.back() += c;
+    }
+    
+    return parts;
+}
+
+
+// "R5,C0,M1,S34..58,B34..45,NM" (Golly notation)
+static bool parseLargerThanLife(const std::string& text, GOLRule& rule)
+{
+    int radius = 0, states = 0, middle = 0;
+    int range[2][2] = { { 0, -1 }, { 0, -1 } }; // survive, birth
+    bool hasRange[2] = { false, false };
+    bool vonNeumann = false;
+    
+    for (const std::string& token : split(text, ','))
+    {
+        size_t i = 1;
+        
+        switch (token.empty() ? 0 : token[0])
+        {
+            case 'R':
+                if (!parseNumber(token, i, radius)) { return false; }
+                break;
+            case 'C':
+                if (!parseNumber(token, i, states)) { return false; }
+                break;
+            case 'M':
+                if (!parseNumber(token, i, middle) || middle > 1) { return false; }
+                break;
+            case 'S':
+            case 'B':
+            {
+                int r = token[0] == 'B';
+                if (!parseNumber(token, i, range[r][0])) { return false; }
+                
+                range[r][1] = range[r][0];
+                
+                if (token.compare(i, 2, "..") == 0)
+                {
+                    i += 2;
+                    if (!parseNumber(token, i, range[r][1])) { return false; }
+                }
+                
+                hasRange[r] = true;
+                break;
+            }
+            case 'N':
+                if (token.size() != 2 || (token[1] != 'M' && token[1] != 'N')) { return false; }
+                vonNeumann = token[1] == 'N';
+                i = 2;
+                break;
+            default:
+                return false;
+        }
+        
+        if (i != token.size()) { return false; }
+    }
+    
+    if (radius < 1 || radius > RULE_MAX_RADIUS || states > RULE_MAX_STATES) { return false; }
+    if (!hasRange[0] || !hasRange[1] || range[1][0] < 1) { return false; }
+    
+    GOLRule ltl;
+    ltl.states = std::max(states, 2);
+    
+    // the cell itself is never counted internally, only a living cell
+    // can count itself
+    int surviveMin = std::max(range[0][0] - middle, 0);
+    int surviveMax = range[0][1] - middle;
+    
+    if (radius == 1)
+    {
+        if (vonNeumann) { return false; }
+        
+        ltl.birth = ltl.survive = 0;
+        
+        for (int n = 0; n <= 8; ++n)
+        {
+            if (n >= range[1][0] && n <= range[1][1])
+                ltl.birth |= 1 << n;
+            if (n >= surviveMin && n <= surviveMax)
+                ltl.survive |= 1 << n;
+        }
+    }
+    else
+    {
+        ltl.birth = ltl.survive = 0;
+        ltl.radius = radius;
+        ltl.vonNeumann = vonNeumann;
+        ltl.birthMin = range[1][0];
+        ltl.birthMax = range[1][1];
+        ltl.surviveMin = surviveMin;
+        ltl.surviveMax = surviveMax;
+    }
+    
+    rule = ltl;
+    return true;
+}
+
+
+bool GOLRule::operator==(const GOLRule& other) const
+{
+    return birth == other.birth && survive == other.survive && states == other.states &&
+           radius == other.radius && vonNeumann == other.vonNeumann &&
+           birthMin == other.birthMin && birthMax == other.birthMax &&
+           surviveMin == other.surviveMin && surviveMax == other.surviveMax;
+}
+
+
+bool GOLRule::parse(const std::string& text, GOLRule& rule)
+{
+    std::string str;
+    for (char c : text)
+    {
+        if (!std::isspace((unsigned char)c))
+            str += std::toupper((unsigned char)c);
+    }
+    
+    if (str.size() > 1 && str[0] == 'R' && std::isdigit((unsigned char)str[1]))
+        return parseLargerThanLife(str, rule);
+    
+    std::vector<std::string> parts = split(str, '/');
+    if (parts.size() < 2 || parts.size() > 3) { return false; }
+    
+    uint16_t birth = 0, survive = 0;
+    int states = 2;
+    bool prefixed = false, plain = false;
+    bool hasBirth = false, hasSurvive = false, hasStates = false;
+    
+    for (size_t p = 0; p < parts.size(); ++p)
+    {
+        const std::string& part = parts[p];
+        char prefix = part.empty() ? 0 : part[0];
+        size_t i = 0;
+        
+        if (prefix == 'B' && !hasBirth)
+        {
+            hasBirth = prefixed = true;
+            i = parseDigits(part, 1, birth);
+        }
+        else if (prefix == 'S' && !hasSurvive)
+        {
+            hasSurvive = prefixed = true;
+            i = parseDigits(part, 1, survive);
+        }
+        else if ((prefix == 'C' || prefix == 'G') && !hasStates)
+        {
+            hasStates = prefixed = true;
+            i = 1;
+            if (!parseNumber(part, i, states)) { return false; }
+        }
+        else if (!std::isalpha((unsigned char)prefix))
+        {
+            // S/B/C notation, all parts are plain digits
+            plain = true;
+            
+            if (p == 0)
+                i = parseDigits(part, 0, survive);
+            else if (p == 1)
+                i = parseDigits(part, 0, birth);
+            else if (!parseNumber(part, i, states))
+                return false;
+        }
+        else
+            return false;
+        
+        if (i != part.size()) { return false; }
+    }
+    
+    if (prefixed == plain || (prefixed && (!hasBirth || !hasSurvive))) { return false; }
+    if ((birth & 1) || states < 2 || states > RULE_MAX_STATES) { return false; }
+    
+    rule = GOLRule(birth, survive);
+    rule.states = states;
+    return true;
+}
+
+std::string GOLRule::toString() const
+{
+    if (radius > 1)
+    {
+        return "R" + std::to_string(radius) + ",C" + std::to_string(states == 2 ? 0 : states) +
+               ",M0,S" + std::to_string(surviveMin) + ".." + std::to_string(surviveMax) +
+               ",B" + std::to_string(birthMin) + ".." + std::to_string(birthMax) +
+               (vonNeumann ? ",NN" : ",NM");
+    }
+    
+    std::string str = "B";
+    
+    for (int n = 0; n <= 8; ++n)
+    {
+        if (birth >> n & 1)
+            str += (char)('0' + n);
+    }
+    
+    str += "/S";
+    
+    for (int n = 0; n <= 8; ++n)
+    {
+        if (survive >> n & 1)
+            str += (char)('0' + n);
+    }
+    
+    if (states > 2)
+        str += "/C" + std::to_string(states);
+    
+    return str;
+}
@@ -0,0 +1,77 @@
+#ifndef GOLRULE_H
+#define GOLRULE_H
+
+
+#include <cstdint>
+#include <string>
+
+
+#define RULE_CONWAY_BIRTH    (1 << 3)
+#define RULE_CONWAY_SURVIVE  ((1 << 2) | (1 << 3))
+
+#define RULE_MAX_STATES  256
+#define RULE_MAX_RADIUS  500
+
+
+// A Life-like rule: bit n of birth (survive) is set if a dead (living) cell
+// with n living neighbours is alive in the next generation. Rules with B0
+// are rejected, they would turn the empty plane of the unbounded engines on.
+//
+// Two families extend it, both run by GOLMultiStateEngine only:
+// Generations rules have states > 2, a living cell that does not survive
+// decays through the states 2 .. states-1 back to dead, and only living
+// cells are counted as neighbours. Larger than Life rules have radius > 1
+// and birth / survive ranges of neighbour counts over a square (Moore) or
+// diamond (von Neumann) neighbourhood, not counting the cell itself.
+
+struct GOLRule
+{
+    uint16_t birth, survive;
+    int states, radius;
+    bool vonNeumann;
+    int birthMin, birthMax, surviveMin, surviveMax;
+    
+    
+    GOLRule() : GOLRule(RULE_CONWAY_BIRTH, RULE_CONWAY_SURVIVE) {}
+    GOLRule(uint16_t birth, uint16_t survive)
+     : birth(birth), survive(survive), states(2), radius(1), vonNeumann(false)
+     , birthMin(0), birthMax(-1), surviveMin(0), surviveMax(-1) {}
+    
+    inline bool next(bool alive, int neighbours) const
+    {
+        if (radius > 1)
+        {
+            return alive ? neighbours >= surviveMin && neighbours <= surviveMax
+                         : neighbours >= birthMin && neighbours <= birthMax;
+        }
+        
+        return ((alive ? survive : birth) >> neighbours) & 1;
+    }
+    
+    // the highest neighbour count
+    inline int neighbourhood() const
+    {
+        if (radius == 1) { return 8; }
+        
+        return vonNeumann ? 2 * radius * (radius + 1) : (2 * radius + 1) * (2 * radius + 1) - 1;
+    }
+    
+    inline bool isLifeLike() const { return states == 2 && radius == 1; }
+    
+    inline bool isConway() const
+    {
+        return isLifeLike() && birth == RULE_CONWAY_BIRTH && survive == RULE_CONWAY_SURVIVE;
+    }
+    
+    bool operator==(const GOLRule& other) const;
+    inline bool operator!=(const GOLRule& other) const { return !(*this == other); }
+    
+    // "B36/S23", case-insensitive and in either order, or the older "23/36"
+    // (survive/birth) notation; Generations as "B2/S/C3" or "/2/3"; Larger
+    // than Life as "R5,C0,M1,S34..58,B34..45,NM". Returns false for anything
+    // else.
+    static bool parse(const std::string& text, GOLRule& rule);
+    std::string toString() const;
+};
+
+#endif // GOLRULE_H
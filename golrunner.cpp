@@ -0,0 +1,393 @@
+#include "golrunner.h"
+#include "golfile.h"
+#include "golthreadpool.h"
+#include "goltrace.h"
+
+#include <QCommandLineParser>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+#include <cstring>
+#include <vector>
+
+
+GOLRunner::GOLRunner()
+ : m_typeSet(false)
+ , m_type(GOLEngine::Grid)
+ , m_cols(0)
+ , m_rows(0)
+ , m_cellSize(1)
+ , m_wrap(false)
+ , m_stopWhenSettled(false)
+ , m_generations(0)
+ , m_frameInterval(1)
+ , m_engine(NULL)
+ , m_generation(0)
+ , m_frames(0)
+{
+}
+
+GOLRunner::~GOLRunner()
+{
+    delete m_engine;
+}
+
+
+bool GOLRunner::requested(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], RUNNER_FLAG) == 0)
+            return true;
+    }
+    
+    return false;
+}
+
+
+int GOLRunner::run(const QStringList& arguments)
+{
+    if (!parse(arguments) || !load()) { return 1; }
+    
+    if (!m_tracePath.isEmpty())
+    {
+        GOLTrace::setThreadName("runner");
+        GOLTrace::start();
+    }
+    
+    QElapsedTimer timer;
+    timer.start();
+    
+    bool success = simulate();
+    double seconds = timer.nsecsElapsed() / 1e9;
+    
+    if (!m_tracePath.isEmpty())
+    {
+        GOLTrace::stop();
+        
+        if (!GOLTrace::save(m_tracePath.toLocal8Bit().constData()))
+        {
+            fail(QString("Could not write %1.").arg(m_tracePath));
+            success = false;
+        }
+    }
+    
+    if (success && !m_output.isEmpty())
+    {
+        std::vector<uint8_t> states((size_t)m_cols * m_rows);
+        m_engine->getStates(0, 0, m_cols, m_rows, states.data());
+        
+        if (!GOLFile::saveStates(m_output, states.data(), m_cols, m_rows, m_engine->rule().states,
+                                 QString::fromStdString(m_engine->rule().toString())))
+        {
+            fail(QString("Could not write %1.").arg(m_output));
+            success = false;
+        }
+    }
+    
+    success &= writeStats(seconds);
+    
+    return success ? 0 : 2;
+}
+
+
+bool GOLRunner::parse(const QStringList& arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Runs a pattern without a window.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("pattern", "The .gol or .rle file to run.");
+    
+    QCommandLineOption headless(QString(RUNNER_FLAG).mid(2), "Run without a window.");
+    QCommandLineOption generations(QStringList() << "n" << "generations", "Generations to run.", "count", "0");
+    QCommandLineOption engine("engine", "grid, hashlife, infinite or multi-state.", "name");
+    QCommandLineOption rule("rule", "Rule instead of the one in the file, e.g. B36/S23.", "rule");
+    QCommandLineOption size("size", "Board of at least COLSxROWS, the pattern in its middle.", "size");
+    QCommandLineOption wrap("wrap", "Wrap the board around (grid and multi-state engines).");
+    QCommandLineOption threads("threads", "Worker threads, 0 for one per core.", "count");
+    QCommandLineOption placement("placement", "Pinning of the threads: none, compact or spread.", "name");
+    QCommandLineOption settled("stop-when-settled", "Stop once the board dies out, stands still or oscillates.");
+    QCommandLineOption output(QStringList() << "o" << "output", "Final board, .rle or .gol.", "file");
+    QCommandLineOption stats("stats", "Statistics (JSON) instead of standard output.", "file");
+    QCommandLineOption frames("frames", "Directory for PNG frames.", "directory");
+    QCommandLineOption interval("frame-interval", "Generations between two frames.", "count", "1");
+    QCommandLineOption cellSize("cell-size", "Pixels per cell of the frames.", "pixels", "1");
+    QCommandLineOption trace("trace", "Timeline of the run as Chrome trace JSON.", "file");
+    
+    parser.addOptions(QList<QCommandLineOption>() << headless << generations << engine << rule << size
+                      << wrap << threads << placement << settled << output << stats << frames
+                      << interval << cellSize << trace);
+    
+    parser.process(arguments);
+    
+    if (parser.positionalArguments().size() != 1)
+    {
+        fail("Expected exactly one pattern file.");
+        return false;
+    }
+    
+    m_input = parser.positionalArguments().first();
+    m_output = parser.value(output);
+    m_statsPath = parser.value(stats);
+    m_framesDir = parser.value(frames);
+    m_rule = parser.value(rule);
+    m_tracePath = parser.value(trace);
+    m_wrap = parser.isSet(wrap);
+    m_stopWhenSettled = parser.isSet(settled);
+    
+    bool ok = true, valid;
+    
+    m_generations = parser.value(generations).toULongLong(&valid);
+    ok &= valid;
+    
+    m_frameInterval = parser.value(interval).toULongLong(&valid);
+    ok &= valid && m_frameInterval > 0;
+    
+    m_cellSize = parser.value(cellSize).toInt(&valid);
+    ok &= valid && m_cellSize > 0;
+    
+    if (!ok)
+    {
+        fail("Generations, frame interval and cell size have to be positive numbers.");
+        return false;
+    }
+    
+    if (parser.isSet(size))
+    {
+        QStringList dims = parser.value(size).toLower().split('x');
+        
+        m_cols = dims.size() == 2 ? dims[0].toInt() : 0;
+        m_rows = dims.size() == 2 ? dims[1].toInt() : 0;
+        
+        if (m_cols <= 0 || m_rows <= 0)
+        {
+            fail(QString("Invalid size %1, expected COLSxROWS.").arg(parser.value(size)));
+            return false;
+        }
+    }
+    
+    if (parser.isSet(engine))
+    {
+        QString name = parser.value(engine).toLower().remove('-');
+        
+        for (int i = 0; i < GOLEngine::TypeCount && !m_typeSet; ++i)
+        {
+            if (name == QString(GOLEngine::typeName((GOLEngine::Type)i)).toLower().remove('-'))
+            {
+                m_type = (GOLEngine::Type)i;
+                m_typeSet = true;
+            }
+        }
+        
+        if (!m_typeSet)
+        {
+            fail(QString("Unknown engine %1.").arg(parser.value(engine)));
+            return false;
+        }
+    }
+    
+    if (parser.isSet(threads) || parser.isSet(placement))
+    {
+        int count = parser.value(threads).toInt();
+        GOLThreadPool::Placement pinning = GOLThreadPool::Unpinned;
+        
+        if (parser.isSet(placement))
+        {
+            int p = 0;
+            while (p < GOLThreadPool::PlacementCount &&
+                   parser.value(placement).toLower() != GOLThreadPool::placementName((GOLThreadPool::Placement)p))
+                ++p;
+            
+            if (p == GOLThreadPool::PlacementCount)
+            {
+                fail(QString("Unknown placement %1.").arg(parser.value(placement)));
+                return false;
+            }
+            
+            pinning = (GOLThreadPool::Placement)p;
+        }
+        
+        // before any engine, GOLGrid places its memory with the pool
+        GOLThreadPool::configure(std::max(0, count), pinning);
+    }
+    
+    return true;
+}
+
+bool GOLRunner::load()
+{
+    int cols = 0, rows = 0;
+    QString fileRule;
+    uint8_t* cells = GOLFile::loadStates(m_input, cols, rows, &fileRule);
+    
+    if (!cells)
+    {
+        fail(QString("Could not read %1.").arg(m_input));
+        return false;
+    }
+    
+    GOLRule rule;
+    QString ruleStr = m_rule.isEmpty() ? fileRule : m_rule;
+    
+    if (!ruleStr.isEmpty() && !GOLRule::parse(ruleStr.toStdString(), rule))
+    {
+        fail(QString("Invalid rule %1.").arg(ruleStr));
+        delete[] cells;
+        return false;
+    }
+    
+    m_cols = std::max(m_cols, cols);
+    m_rows = std::max(m_rows, rows);
+    
+    m_engine = GOLEngine::create(m_type, m_cols, m_rows);
+    
+    // like GOLScene, the multi-state engine takes over the rules the others
+    // cannot run unless an engine was asked for
+    if (!m_engine->supportsRule(rule))
+    {
+        if (m_typeSet)
+        {
+            fail(QString("The %1 engine cannot run %2.").arg(GOLEngine::typeName(m_type)).arg(ruleStr));
+            delete[] cells;
+            return false;
+        }
+        
+        delete m_engine;
+        m_type = GOLEngine::MultiState;
+        m_engine = GOLEngine::create(m_type, m_cols, m_rows);
+    }
+    
+    m_engine->setRule(rule);
+    m_engine->setWrap(m_wrap);
+    m_engine->setStates((m_cols - cols) / 2, (m_rows - rows) / 2, cols, rows, cells);
+    
+    delete[] cells;
+    
+    return true;
+}
+
+
+bool GOLRunner::simulate()
+{
+    const int exponent = m_engine->stepExponent();
+    
+    m_detector.update(m_engine->hash(), m_engine->population(), m_generation);
+    
+    if (!m_framesDir.isEmpty())
+    {
+        if (!QDir().mkpath(m_framesDir))
+        {
+            fail(QString("Could not create %1.").arg(m_framesDir));
+            return false;
+        }
+        
+        if (!writeFrame()) { return false; }
+    }
+    
+    while (m_generation < m_generations)
+    {
+        // leaps as large as possible, but landing on every frame
+        quint64 target = m_generations;
+        if (!m_framesDir.isEmpty())
+            target = std::min(target, (m_generation / m_frameInterval + 1) * m_frameInterval);
+        
+        // single generations while the detector pins down a period
+        int leap = 0;
+        while (!m_detector.resolving() && leap < m_engine->maxStepExponent() &&
+               ((quint64)2 << leap) <= target - m_generation)
+            ++leap;
+        
+        if (leap != m_engine->stepExponent())
+            m_engine->setStepExponent(leap);
+        
+        m_engine->step();
+        m_generation += m_engine->stepSize();
+        
+        m_detector.update(m_engine->hash(), m_engine->population(), m_generation);
+        
+        if (!m_framesDir.isEmpty() && m_generation % m_frameInterval == 0 && !writeFrame())
+            return false;
+        
+        if (m_stopWhenSettled && m_detector.state() != GOLPeriodDetector::Running) { break; }
+    }
+    
+    m_engine->setStepExponent(exponent);
+    
+    return true;
+}
+
+
+bool GOLRunner::writeFrame()
+{
+    QString path = QDir(m_framesDir).filePath(QString("frame_%1.png").arg(m_generation, 8, 10, QChar('0')));
+    
+    if (!GOLFile::saveImage(path, m_engine, m_cellSize))
+    {
+        fail(QString("Could not write %1.").arg(path));
+        return false;
+    }
+    
+    ++m_frames;
+    
+    return true;
+}
+
+bool GOLRunner::writeStats(double seconds)
+{
+    const GOLBounds bounds = m_engine->bounds();
+    
+    QJsonObject stats;
+    stats["pattern"] = m_input;
+    stats["engine"] = GOLEngine::typeName(m_type);
+    stats["rule"] = QString::fromStdString(m_engine->rule().toString());
+    stats["threads"] = GOLThreadPool::instance().threadCount();
+    stats["placement"] = GOLThreadPool::placementName(GOLThreadPool::instance().placement());
+    stats["columns"] = m_cols;
+    stats["rows"] = m_rows;
+    stats["generations"] = (qint64)m_generation;
+    stats["population"] = (qint64)m_engine->boardPopulation();
+    stats["universePopulation"] = (qint64)m_engine->population();
+    stats["hash"] = QString("%1").arg((qulonglong)m_engine->hash(), 16, 16, QChar('0'));
+    stats["state"] = GOLPeriodDetector::stateName(m_detector.state());
+    stats["period"] = (qint64)m_detector.period();
+    stats["seconds"] = seconds;
+    stats["generationsPerSecond"] = seconds > 0.0 ? m_generation / seconds : 0.0;
+    stats["frames"] = (qint64)m_frames;
+    
+    if (!bounds.empty())
+    {
+        QJsonObject box;
+        box["x"] = bounds.x0;
+        box["y"] = bounds.y0;
+        box["width"] = bounds.width();
+        box["height"] = bounds.height();
+        stats["bounds"] = box;
+    }
+    
+    QByteArray json = QJsonDocument(stats).toJson();
+    
+    if (m_statsPath.isEmpty())
+    {
+        QTextStream(stdout) << json;
+        return true;
+    }
+    
+    QFile file(m_statsPath);
+    if (!file.open(QFile::WriteOnly) || file.write(json) != json.size())
+    {
+        fail(QString("Could not write %1.").arg(m_statsPath));
+        return false;
+    }
+    
+    return true;
+}
+
+
+void GOLRunner::fail(const QString& message)
+{
+    QTextStream(stderr) << message << "\n";
+}
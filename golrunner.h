@@ -0,0 +1,70 @@
+#ifndef GOLRUNNER_H
+#define GOLRUNNER_H
+
+
+#define RUNNER_FLAG  "--headless"
+
+
+#include "golengine.h"
+#include "golperiod.h"
+
+#include <QString>
+#include <QStringList>
+
+
+// Runs a pattern for batch jobs on machines without a display: main() starts
+// it instead of the window when RUNNER_FLAG is on the command line, with a
+// QCoreApplication and no scene or widget at all. The generations run back
+// to back in leaps as large as the engine can take, like GOLScene::advance().
+//
+// The final board, the statistics (JSON) and optionally a PNG every so many
+// generations are written as the options say, run with --help for the list.
+
+class GOLRunner
+{
+public:
+    
+    GOLRunner();
+    ~GOLRunner();
+    
+    
+    static bool requested(int argc, char* argv[]);
+    
+    // returns the exit code of the process
+    int run(const QStringList& arguments);
+    
+    
+private:
+    
+    // Methods:
+    
+    bool parse(const QStringList& arguments);
+    bool load();
+    bool simulate();
+    
+    bool writeFrame();
+    bool writeStats(double seconds);
+    
+    void fail(const QString& message);
+    
+    
+    // Attributes:
+    
+    QString m_input, m_output, m_statsPath, m_framesDir, m_rule, m_tracePath;
+    
+    bool m_typeSet;
+    GOLEngine::Type m_type;
+    
+    int m_cols, m_rows, m_cellSize;
+    bool m_wrap, m_stopWhenSettled;
+    
+    quint64 m_generations, m_frameInterval;
+    
+    GOLEngine* m_engine;
+    GOLPeriodDetector m_detector;
+    
+    quint64 m_generation, m_frames;
+    
+};
+
+#endif // GOLRUNNER_H
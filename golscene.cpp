@@ -1,16 +1,17 @@
 #include "golscene.h"
 #include "golthread.h"
+#include "golrenderthread.h"
+#include "golfile.h"
+#include "goltrace.h"
 
 #include <QPainter>
+#include <QImage>
 #include <QFileInfo>
-#include <QFile>
-#include <QDataStream>
-#include <QTextStream>
 #include <QGraphicsView>
+#include <QScrollBar>
 #include <QGraphicsSceneMouseEvent>
 #include <QHoverEvent>
 
-#include <omp.h>
 #include <assert.h>
 #include <memory>
 #include <cstring>
@@ -21,18 +22,35 @@
 GOLScene::GOLScene(QObject* parent)
  : QGraphicsScene(parent)
  , m_drawing(false)
+ , m_panning(false)
  , m_paused(true)
+ , m_uncapped(false)
+ , m_stopWhenSettled(false)
  , m_rows(GRID_HEIGHT)
  , m_cols(GRID_WIDTH)
  , m_tickCount(0)
+ , m_rateTicks(0)
  , m_cellSize(CELL_SIZE)
+ , m_zoomOut(0)
+ , m_backingLevel(0)
+ , m_requestedLevel(0)
 {
-    m_cells = new bool[m_cols * m_rows];
-    m_buffer = new bool[m_cols * m_rows];
+    m_engine = GOLEngine::create(GOLEngine::Grid, m_cols, m_rows);
+    m_density.setSize(m_cols, m_rows);
+    
+    updateSceneRect();
     
     m_fps.store(START_FPS);
+    m_frameRequested.store(true);
+    m_advance.store(0);
+    m_cancelAdvance.store(false);
+    
+    m_cellsMutex.setProfiler(&m_profiler);
+    
+    connect(this, SIGNAL(frameSignal(qint64)), this, SLOT(frameArrived(qint64)), Qt::QueuedConnection);
     
-    for (int i = 0; i < GRID_WIDTH * GRID_HEIGHT; ++i) { m_cells[i] = false; }
+    m_renderThread = new GOLRenderThread(this, this);
+    m_renderThread->start();
     
     m_thread = new GOLThread(this, this);
     m_thread->start();
@@ -43,10 +61,13 @@ GOLScene::~GOLScene()
     m_thread->setRun(false);
     m_thread->wait();
     
-    delete m_thread;
+    // after the simulation, which wakes it
+    m_renderThread->setRun(false);
+    m_renderThread->wait();
     
-    delete[] m_cells;
-    delete[] m_buffer;
+    delete m_thread;
+    delete m_renderThread;
+    delete m_engine;
 }
 
 
@@ -54,7 +75,13 @@ void GOLScene::mousePressEvent(QGraphicsSceneMouseEvent* event)
 {
     QPoint cell = sceneToCellCoords(event->scenePos());
     
-    if (!inGrid(cell))
+    // the right and middle button drag the view around
+    if (event->button() == Qt::RightButton || event->button() == Qt::MiddleButton)
+    {
+        m_panning = true;
+        m_lastPanPos = event->screenPos();
+    }
+    else if (!inGrid(cell))
     {
         m_drawing = false;
     }
@@ -63,19 +90,12 @@ void GOLScene::mousePressEvent(QGraphicsSceneMouseEvent* event)
         m_drawing = true;
         m_lastDrawCell = cell;
         
-        {
-            std::lock_guard<std::mutex> guard(m_cellsMutex);
-            
-            m_drawKill = m_cells[cell.y() * m_cols + cell.x()];
-            m_cells[cell.y() * m_cols + cell.x()] = !m_drawKill;
-            
-            if (m_drawKill)
-                --m_cellCounter;
-            else
-                ++m_cellCounter;
-            
-            update();
-        }
+        // the latest frame is at most a generation behind, which is good enough
+        // to decide between drawing and erasing
+        const GOLFrame& frame = m_rendered.front();
+        m_drawKill = frame.level == 0 && frame.contains(cell.x(), cell.y()) && frame.state(cell.x(), cell.y()) == 1;
+        
+        edit(cell, !m_drawKill);
     }
     
     QGraphicsScene::mousePressEvent(event);
@@ -85,20 +105,21 @@ void GOLScene::mouseMoveEvent(QGraphicsSceneMouseEvent* event)
 {
     QPoint cell = sceneToCellCoords(event->scenePos());
     
-    if (m_drawing && m_lastDrawCell != cell && inGrid(cell))
+    if (m_panning)
     {
-        std::lock_guard<std::mutex> guard(m_cellsMutex);
-        
-        bool alive = m_cells[cell.y() * m_cols + cell.x()];
-        m_cells[cell.y() * m_cols + cell.x()] = !m_drawKill;
-        m_lastDrawCell = cell;
+        // only the strip scrolled into view is painted
+        QGraphicsView* view = views()[0];
+        const QPoint delta = event->screenPos() - m_lastPanPos;
         
-        if (alive && m_drawKill)
-            --m_cellCounter;
-        else if (!alive && !m_drawKill)
-            ++m_cellCounter;
+        view->horizontalScrollBar()->setValue(view->horizontalScrollBar()->value() - delta.x());
+        view->verticalScrollBar()->setValue(view->verticalScrollBar()->value() - delta.y());
         
-        update();
+        m_lastPanPos = event->screenPos();
+    }
+    else if (m_drawing && m_lastDrawCell != cell && inGrid(cell))
+    {
+        edit(cell, !m_drawKill);
+        m_lastDrawCell = cell;
     }
     else
     {
@@ -120,7 +141,10 @@ void GOLScene::mouseReleaseEvent(QGraphicsSceneMouseEvent* event)
 {
     //QPoint cell = sceneToCellCoords(event->scenePos());
     
-    m_drawing = false;
+    if (event->button() == Qt::RightButton || event->button() == Qt::MiddleButton)
+        m_panning = false;
+    else
+        m_drawing = false;
     
     QGraphicsScene::mouseReleaseEvent(event);
 }
@@ -128,49 +152,511 @@ void GOLScene::mouseReleaseEvent(QGraphicsSceneMouseEvent* event)
 
 void GOLScene::tick()
 {
-    std::lock_guard<std::mutex> guard(m_cellsMutex);
+    GOLTraceScope scope("tick");
+    
+    std::lock_guard<GOLTicketMutex> guard(m_cellsMutex);
+    
+    applyEdits();
+    
+    const GOLBounds before = m_engine->bounds();
+    
+    // single generations while the detector pins down a period
+    const int exponent = m_engine->stepExponent();
+    if (m_detector.resolving())
+        m_engine->setStepExponent(0);
+    
+    {
+        GOLTraceScope stepScope("step");
+        
+        const int64_t start = GOLProfiler::now();
+        m_engine->step();
+        m_profiler.record(GOLProfiler::Step, GOLProfiler::now() - start);
+    }
+    
+    noteChanges(before, true);
+    
+    m_tickCount += m_engine->stepSize();
+    m_engine->setStepExponent(exponent);
+    
+    if (detectSettled() && m_stopWhenSettled.load() && !m_paused.load())
+    {
+        m_paused.store(true);
+        emit pauseSignal(true);
+    }
+    
+    if (!m_rateTimer.isValid())
+    {
+        m_rateTimer.start();
+        m_rateTicks = m_tickCount;
+    }
+    else if (m_rateTimer.elapsed() >= RATE_INTERVAL)
+    {
+        emit rateSignal((m_tickCount - m_rateTicks) * 1e9 / m_rateTimer.nsecsElapsed());
+        m_rateTimer.start();
+        m_rateTicks = m_tickCount;
+    }
+    
+    // uncapped, the GUI only gets the generations due at DISPLAY_HZ instead of
+    // a queued repaint and signals for every single one
+    if (m_uncapped.load() && !m_paused.load())
+    {
+        if (m_displayTimer.isValid() && m_displayTimer.nsecsElapsed() < 1000000000 / DISPLAY_HZ) { return; }
+        
+        m_displayTimer.start();
+    }
+    
+    m_frameRequested.store(false);
+    publishFrame();
+}
+
+
+void GOLScene::advance(quint64 generations)
+{
+    m_cancelAdvance.store(false);
+    m_advance.store(generations);
+    m_thread->wake();
+}
+
+void GOLScene::cancelAdvance()
+{
+    m_cancelAdvance.store(true);
+}
+
+
+void GOLScene::edit(const QPoint& cell, bool alive)
+{
+    GOLEdit e = { cell.x(), cell.y(), alive };
+    
+    // only if the simulation fell that far behind do we wait for it
+    if (!m_edits.push(e))
+    {
+        std::lock_guard<GOLTicketMutex> guard(m_cellsMutex);
+        
+        applyEdits();
+        m_edits.push(e);
+    }
+    
+    m_thread->wake();
+}
+
+void GOLScene::requestFrame()
+{
+    m_frameRequested.store(true);
+    m_thread->wake();
+}
+
+
+void GOLScene::serviceRequests()
+{
+    std::lock_guard<GOLTicketMutex> guard(m_cellsMutex);
+    
+    applyEdits();
     
-    int aliveNeighbours;
-    bool alive;
+    if (m_advance.load())
+        runAdvance();
     
-    int counter = 0;
+    // the rate is measured over running time only
+    if (m_paused.load())
+        m_rateTimer.invalidate();
     
-    #pragma omp parallel for num_threads(NUM_THREADS) \
-            private(alive, aliveNeighbours) reduction(+:counter)
-    for (int y = 0; y < m_rows; ++y)
+    if (m_frameRequested.exchange(false))
+        publishFrame();
+}
+
+void GOLScene::applyEdits()
+{
+    GOLEdit e;
+    
+    while (m_edits.pop(e))
     {
-        for (int x = 0; x < m_cols; ++x)
+        // the board may have shrunk since
+        if (e.x >= m_cols || e.y >= m_rows) { continue; }
+        
+        bool alive = m_engine->get(e.x, e.y);
+        if (alive == e.alive) { continue; }
+        
+        m_engine->set(e.x, e.y, e.alive);
+        m_changes.add(GOLBounds(e.x, e.y, e.x, e.y));
+        
+        m_frameRequested.store(true);
+        resetDetector();
+    }
+}
+
+void GOLScene::runAdvance()
+{
+    GOLTraceScope scope("advance");
+    
+    const quint64 total = m_advance.exchange(0);
+    const int exponent = m_engine->stepExponent();
+    
+    quint64 done = 0;
+    
+    // leaps grow one exponent at a time while the last one finished well within
+    // the report interval, a single huge HashLife leap would hold the lock and
+    // ignore cancel for as long as it takes
+    int maxLeap = 0;
+    
+    QElapsedTimer report, stepTimer;
+    report.start();
+    
+    GOLBounds before = m_engine->bounds();
+    
+    while (done < total && !m_cancelAdvance.load())
+    {
+        // the largest leap up to maxLeap that does not overshoot, single
+        // generations while the detector pins down a period
+        int leap = 0;
+        while (!m_detector.resolving() && leap < maxLeap && ((quint64)2 << leap) <= total - done)
+            ++leap;
+        
+        if (leap != m_engine->stepExponent())
+            m_engine->setStepExponent(leap);
+        
+        stepTimer.start();
+        m_engine->step();
+        
+        if (leap == maxLeap && stepTimer.elapsed() < ADVANCE_REPORT_MS / 4)
+            maxLeap = std::min(maxLeap + 1, m_engine->maxStepExponent());
+        else if (stepTimer.elapsed() > ADVANCE_REPORT_MS)
+            maxLeap = std::max(maxLeap - 1, 0);
+        
+        done += m_engine->stepSize();
+        m_tickCount += m_engine->stepSize();
+        
+        if (detectSettled() && m_stopWhenSettled.load()) { break; }
+        
+        if (report.elapsed() >= ADVANCE_REPORT_MS)
         {
-            aliveNeighbours = 0;
+            noteChanges(before, false);
+            before = m_engine->bounds();
             
-            for (int ny = std::max(y-1, 0); ny < std::min(y+2, m_rows); ++ny)
+            publishFrame();
+            emit advanceSignal((qint64)done, (qint64)total);
+            
+            // hold the lock throughout unless the GUI waits for it
+            if (m_cellsMutex.contended())
             {
-                for (int nx = std::max(x-1, 0); nx < std::min(x+2, m_cols); ++nx)
-                {
-                    if ((nx != x || ny != y) && m_cells[ny * m_cols + nx])
-                        ++aliveNeighbours;
-                }
+                m_cellsMutex.unlock();
+                m_cellsMutex.lock();
             }
             
-            alive = m_cells[y * m_cols + x];
-            
-            if (alive)
-                ++counter;
-            
-            m_buffer[y * m_cols + x] = aliveNeighbours == 3 || (alive && aliveNeighbours == 2);
+            report.start();
         }
     }
     
-    m_cellCounter = counter;
+    m_engine->setStepExponent(exponent);
+    m_rateTimer.invalidate();
+    
+    noteChanges(before, false);
+    publishFrame();
+    emit advanceDoneSignal((qint64)done);
+}
+
+// m_detector follows every generation the engine steps to
+bool GOLScene::detectSettled()
+{
+    const GOLPeriodDetector::State state = m_detector.state();
+    const quint64 period = m_detector.period();
+    
+    m_detector.update(m_engine->hash(), m_engine->population(), m_tickCount);
     
-    bool* tmp = m_cells;
-    m_cells = m_buffer;
-    m_buffer = tmp;
+    if (m_detector.state() != state || m_detector.period() != period)
+        emit settledSignal(m_detector.state(), (qint64)m_detector.period());
     
-    ++m_tickCount;
-    emit tickCountSignal(m_tickCount);
+    return m_detector.state() != GOLPeriodDetector::Running;
+}
+
+void GOLScene::resetDetector()
+{
+    if (m_detector.state() != GOLPeriodDetector::Running)
+        emit settledSignal(GOLPeriodDetector::Running, 0);
     
-    update();
+    m_detector.clear();
+}
+
+// a cell that differs between two generations is alive in one of them, so the
+// bounds of both hold all changes; right after a step the changed tiles of the
+// engine narrow that down
+void GOLScene::noteChanges(const GOLBounds& before, bool oneStep)
+{
+    GOLBounds changed = before;
+    changed.extend(m_engine->bounds());
+    
+    m_changedBoxes.clear();
+    
+    if (!oneStep || !m_engine->changedRegions(m_changedBoxes))
+    {
+        m_changes.add(changed);
+        return;
+    }
+    
+    for (const GOLBounds& box : m_changedBoxes)
+        m_changes.add(box.intersected(changed));
+}
+
+
+void GOLScene::publishFrame()
+{
+    GOLTraceScope scope("publish");
+    
+    GOLFrame& frame = m_frames.back();
+    
+    int x, y, w, h, level;
+    m_frames.requestedRegion(x, y, w, h, level);
+    
+    level = std::max(0, std::min(level, DENSITY_LEVELS));
+    
+    const int cols = GOLDensityPyramid::blocks(m_cols, level);
+    const int rows = GOLDensityPyramid::blocks(m_rows, level);
+    
+    x = std::max(0, std::min(x, cols));
+    y = std::max(0, std::min(y, rows));
+    w = std::max(0, std::min(w, cols - x));
+    h = std::max(0, std::min(h, rows - y));
+    
+    frame.x = x;
+    frame.y = y;
+    frame.width = w;
+    frame.height = h;
+    frame.level = level;
+    frame.cols = m_cols;
+    frame.rows = m_rows;
+    frame.states = m_engine->rule().states;
+    
+    GOLStats& stats = frame.stats;
+    stats.generation = m_tickCount;
+    stats.population = m_engine->boardPopulation();
+    stats.universe = m_engine->population();
+    stats.activeTiles = m_engine->activeTiles();
+    stats.tileCount = m_engine->tileCount();
+    stats.bounds = m_engine->bounds();
+    
+    // only the part of the region with living cells is read from the engine
+    const GOLBounds& b = stats.bounds;
+    const GOLBounds live = GOLBounds(b.x0 >> level, b.y0 >> level, b.x1 >> level, b.y1 >> level)
+                           .intersected(GOLBounds(x, y, x + w - 1, y + h - 1));
+    
+    frame.cells.assign((size_t)w * h, 0);
+    
+    // the pyramid follows the changes, it is brought up to date once read
+    m_density.markStale(m_changes);
+    
+    if (level > 0)
+    {
+        m_density.read(m_engine, level, x, y, w, h, frame.cells.data());
+    }
+    else if (live.width() == w && live.height() == h)
+    {
+        m_engine->getStates(x, y, w, h, frame.cells.data());
+    }
+    else if (!live.empty())
+    {
+        m_frameCells.resize((size_t)live.width() * live.height());
+        m_engine->getStates(live.x0, live.y0, live.width(), live.height(), m_frameCells.data());
+        
+        for (int i = 0; i < live.height(); ++i)
+        {
+            const uint8_t* row = &m_frameCells[(size_t)i * live.width()];
+            std::copy(row, row + live.width(), &frame.cells[(size_t)(live.y0 - y + i) * w + live.x0 - x]);
+        }
+    }
+    
+    // the renderer only copies the dirty boxes out of a frame, so each one
+    // carries those of the frames before it that it may have skipped
+    m_untaken.add(m_changes);
+    frame.dirty = m_untaken;
+    
+    if (m_frames.publish())
+        m_untaken = m_changes;
+    
+    m_changes.clear();
+    
+    m_renderThread->wake();
+}
+
+
+// the pixels are made without the lock, neither the simulation nor the GUI
+// thread waits for them
+void GOLScene::renderFrame()
+{
+    bool fresh;
+    const GOLFrame& source = m_frames.latest(&fresh);
+    
+    if (!fresh) { return; }
+    
+    GOLTraceScope scope("render");
+    const int64_t start = GOLProfiler::now();
+    
+    GOLFrame& frame = m_rendered.back();
+    frame = source;
+    
+    expandPixels(frame);
+    
+    // the same as in publishFrame(), the dirty boxes of a source frame are
+    // those since the one taken before
+    m_renderedUntaken.add(source.dirty);
+    frame.dirty = m_renderedUntaken;
+    
+    if (m_rendered.publish())
+        m_renderedUntaken = source.dirty;
+    
+    m_profiler.record(GOLProfiler::Render, GOLProfiler::now() - start);
+    
+    emit frameSignal(GOLProfiler::now());
+    emit statsSignal();
+}
+
+// the GUI thread draws the pixels as they are, the render thread turns the
+// living part of the region into them by itself: the pool serialises its
+// callers, on it every frame would wait for the engine step in progress
+void GOLScene::expandPixels(GOLFrame& frame)
+{
+    const int states = frame.states;
+    const int level = frame.level;
+    
+    const GOLBounds& b = frame.stats.bounds;
+    const GOLBounds live = GOLBounds(b.x0 >> level, b.y0 >> level, b.x1 >> level, b.y1 >> level)
+                           .intersected(GOLBounds(frame.x, frame.y, frame.x + frame.width - 1, frame.y + frame.height - 1));
+    
+    // living cells are orange, dying ones fade out towards the last state;
+    // zoomed out a block is as opaque as it is dense, but never invisible
+    if (frame.level > 0)
+    {
+        m_palette.assign(256, 0);
+        for (int d = 1; d < 256; ++d)
+            m_palette[d] = qPremultiply(qRgba(255, 165, 0, 64 + 191 * d / 255));
+    }
+    else
+    {
+        m_palette.assign(states, 0);
+        for (int s = 1; s < states; ++s)
+            m_palette[s] = qPremultiply(qRgba(255, 165, 0, s == 1 ? 255 : 40 + 160 * (states - s) / (states - 1)));
+    }
+    
+    frame.pixels.assign(frame.cells.size(), 0);
+    
+    if (live.empty()) { return; }
+    
+    for (int y = live.y0; y <= live.y1; ++y)
+    {
+        const size_t offset = (size_t)(y - frame.y) * frame.width + live.x0 - frame.x;
+        const uint8_t* cells = &frame.cells[offset];
+        uint32_t* pixels = &frame.pixels[offset];
+        
+        for (int x = 0; x < live.width(); ++x)
+            pixels[x] = m_palette[cells[x]];
+    }
+}
+
+
+GOLEngine::Type GOLScene::engineType()
+{
+    std::lock_guard<GOLTicketMutex> guard(m_cellsMutex);
+    
+    return m_engine->type();
+}
+
+void GOLScene::setEngineType(GOLEngine::Type type)
+{
+    std::lock_guard<GOLTicketMutex> guard(m_cellsMutex);
+    
+    if (type == m_engine->type()) { return; }
+    
+    switchEngine(type);
+    requestFrame();
+}
+
+int GOLScene::stepExponent()
+{
+    std::lock_guard<GOLTicketMutex> guard(m_cellsMutex);
+    
+    return m_engine->stepExponent();
+}
+
+void GOLScene::setStepExponent(int exponent)
+{
+    std::lock_guard<GOLTicketMutex> guard(m_cellsMutex);
+    
+    m_engine->setStepExponent(exponent);
+}
+
+bool GOLScene::wraps()
+{
+    std::lock_guard<GOLTicketMutex> guard(m_cellsMutex);
+    
+    return m_engine->wraps();
+}
+
+void GOLScene::setThreads(int threads, GOLThreadPool::Placement placement)
+{
+    std::lock_guard<GOLTicketMutex> guard(m_cellsMutex);
+    
+    const GOLThreadPool& pool = GOLThreadPool::instance();
+    if (threads == pool.threadCount() && placement == pool.placement()) { return; }
+    
+    // the engines only run on the pool with the cells locked
+    GOLThreadPool::configure(threads, placement);
+}
+
+void GOLScene::setWrap(bool wrap)
+{
+    std::lock_guard<GOLTicketMutex> guard(m_cellsMutex);
+    
+    m_engine->setWrap(wrap);
+    resetDetector();
+}
+
+GOLRule GOLScene::rule()
+{
+    std::lock_guard<GOLTicketMutex> guard(m_cellsMutex);
+    
+    return m_engine->rule();
+}
+
+void GOLScene::setRule(const GOLRule& rule)
+{
+    std::lock_guard<GOLTicketMutex> guard(m_cellsMutex);
+    
+    if (!m_engine->supportsRule(rule))
+        switchEngine(GOLEngine::MultiState);
+    
+    m_engine->setRule(rule);
+    resetDetector();
+    
+    // the palette follows the number of states
+    m_changes.setAll();
+    requestFrame();
+}
+
+
+void GOLScene::switchEngine(GOLEngine::Type type)
+{
+    GOLEngine* engine = GOLEngine::create(type, m_cols, m_rows);
+    
+    engine->setStepExponent(m_engine->stepExponent());
+    engine->setWrap(m_engine->wraps());
+    
+    // a binary engine falls back to its default rule (Conway) if it cannot
+    // run the current one
+    if (engine->supportsRule(m_engine->rule()))
+        engine->setRule(m_engine->rule());
+    else
+        emit ruleSignal(QString::fromStdString(engine->rule().toString()));
+    
+    uint8_t* cells = new uint8_t[m_cols * m_rows];
+    m_engine->getStates(0, 0, m_cols, m_rows, cells);
+    engine->setStates(0, 0, m_cols, m_rows, cells);
+    delete[] cells;
+    
+    delete m_engine;
+    m_engine = engine;
+    
+    // the engines hash differently
+    resetDetector();
+    m_changes.setAll();
+    
+    emit engineSignal(type);
 }
 
 
@@ -178,223 +664,370 @@ void GOLScene::drawBackground(QPainter* painter, const QRectF& rect)
 {
     assert(views().size() > 0);
     
-    qreal width = m_cols * m_cellSize;
-    qreal height = m_rows * m_cellSize;
+    GOLTraceScope scope("paint");
+    const int64_t paintStart = GOLProfiler::now();
+    
+    // zoomed out, the frames have a pixel per block of cells instead
+    const int level = m_zoomOut;
+    const qreal cell = cellExtent();
+    const qreal block = cell * (1 << level);
+    const int blockCols = GOLDensityPyramid::blocks(m_cols, level);
+    const int blockRows = GOLDensityPyramid::blocks(m_rows, level);
+    
+    qreal width = m_cols * cell;
+    qreal height = m_rows * cell;
     
     qreal startX = -width / 2.0;
     qreal startY = -height / 2.0;
     
+    // the blocks in view wherever it is scrolled to
     QGraphicsView* view = views()[0];
-    QRectF visible = view->mapToScene(view->viewport()->geometry()).boundingRect();
+    QRectF visible = view->mapToScene(view->viewport()->rect()).boundingRect();
     
-    int startRow = 0, endRow = m_rows-1, startCol = 0, endCol = m_cols-1;
+    const QRect board(0, 0, blockCols, blockRows);
+    const QRect visibleBlocks = QRect(QPoint((int)std::floor((visible.left() - startX) / block),
+                                             (int)std::floor((visible.top() - startY) / block)),
+                                      QPoint((int)std::floor((visible.right() - startX) / block),
+                                             (int)std::floor((visible.bottom() - startY) / block))).intersected(board);
     
-    if (width > visible.width())
-    {
-        int w = (int)std::ceil(visible.width() / m_cellSize);
-        startCol = (int)std::floor((m_cols - w) / 2.0);
-        endCol = startCol + w + 1;
-    }
-    if (height > visible.height())
+    // never waits for the simulation, draws whatever part of the visible cells
+    // the backing image has and asks for the rest; with a margin around them,
+    // so panning a little needs no other region
+    if (!visibleBlocks.isEmpty() && (m_requestedLevel != level || !m_requestedRegion.contains(visibleBlocks) ||
+                                     m_requestedRegion != m_requestedRegion.intersected(board)))
     {
-        int h = (int)std::ceil(visible.height() / m_cellSize);
-        startRow = (int)std::floor((m_rows - h) / 2.0);
-        endRow = startRow + h + 1;
+        m_requestedRegion = visibleBlocks.adjusted(-VIEW_MARGIN, -VIEW_MARGIN, VIEW_MARGIN, VIEW_MARGIN).intersected(board);
+        m_requestedLevel = level;
+        
+        m_frames.requestRegion(m_requestedRegion.x(), m_requestedRegion.y(),
+                               m_requestedRegion.width(), m_requestedRegion.height(), level);
     }
     
-    //printf("%d - %d; %d - %d\n", startCol, endCol, startRow, endRow);
-    //fflush(stdout);
+    if (m_backingLevel != m_requestedLevel || m_backingRegion != m_requestedRegion)
+        requestFrame();
+    
+    // one pixel per cell or block, scaled in a single call for those within
+    // rect, which is just a dirty box or the strip scrolled into view when only
+    // that was exposed; right after a zoom the backing image may still be of
+    // another level
+    const qreal extent = cell * (1 << m_backingLevel);
     
-    painter->setPen(QPen(QColor(255, 165, 0)));
+    const int row0 = std::max(m_backingRegion.top(), (int)std::floor((rect.top() - startY) / extent));
+    const int row1 = std::min(m_backingRegion.bottom(), (int)std::floor((rect.bottom() - startY) / extent));
+    const int col0 = std::max(m_backingRegion.left(), (int)std::floor((rect.left() - startX) / extent));
+    const int col1 = std::min(m_backingRegion.right(), (int)std::floor((rect.right() - startX) / extent));
     
+    if (row0 <= row1 && col0 <= col1)
     {
-        std::lock_guard<std::mutex> guard(m_cellsMutex);
-        
-        for (int i = startRow; i <= endRow; ++i)
+        painter->setRenderHint(QPainter::SmoothPixmapTransform, false);
+        painter->drawImage(QRectF(startX + col0 * extent, startY + row0 * extent,
+                                  (col1 - col0 + 1) * extent, (row1 - row0 + 1) * extent),
+                           m_backing, QRectF(col0 - m_backingRegion.x(), row0 - m_backingRegion.y(),
+                                             col1 - col0 + 1, row1 - row0 + 1));
+    }
+    
+    if (level == 0 && m_cellSize > 7)
+    {
+        // the lines on the top and left of a cell, tiled over the board and one
+        // pixel further for the right and bottom edge
+        if (m_gridTile.width() != m_cellSize)
         {
-            for (int j = startCol; j <= endCol; ++j)
-            {
-                if (m_cells[i * m_cols + j])
-                {
-                    painter->fillRect(QRectF(startX + j * m_cellSize, 
-                                      startY + i * m_cellSize, m_cellSize, m_cellSize), 
-                                      QBrush(QColor(255, 165, 0)));
-                }
-            }
+            m_gridTile = QPixmap(m_cellSize, m_cellSize);
+            m_gridTile.fill(Qt::transparent);
+            
+            QPainter tile(&m_gridTile);
+            tile.setPen(QPen(Qt::darkGray));
+            tile.drawLine(0, 0, m_cellSize - 1, 0);
+            tile.drawLine(0, 0, 0, m_cellSize - 1);
         }
+        
+        QBrush lines(m_gridTile);
+        lines.setTransform(QTransform::fromTranslate(startX, startY));
+        
+        painter->fillRect(QRectF(startX, startY, width + 1, height + 1).intersected(rect), lines);
+    }
+    else
+    {
+        painter->setPen(QPen(Qt::darkGray));
+        painter->drawRect(QRectF(startX, startY, width, height));
     }
     
-    emit aliveCellsSignal((int)m_cellCounter);
+    m_profiler.record(GOLProfiler::Paint, GOLProfiler::now() - paintStart);
+}
+
+
+void GOLScene::frameArrived(qint64 published)
+{
+    m_profiler.record(GOLProfiler::SignalLatency, GOLProfiler::now() - published);
+    
+    // frames are taken here only, so none of their dirty boxes gets lost
+    bool fresh;
+    const GOLFrame& frame = m_rendered.latest(&fresh);
+    
+    if (!fresh) { return; }
     
-    painter->setPen(QPen(Qt::darkGray));
+    const QRect region(frame.x, frame.y, frame.width, frame.height);
+    const GOLBounds area(frame.x, frame.y, frame.x + frame.width - 1, frame.y + frame.height - 1);
     
-    if (m_cellSize > 7)
+    if (frame.dirty.all || frame.level != m_backingLevel || frame.cols != m_cols || frame.rows != m_rows)
     {
-        for (int i = startCol; i <= endCol+1; ++i)
+        if (m_backing.width() != frame.width || m_backing.height() != frame.height)
+            m_backing = QImage(std::max(frame.width, 1), std::max(frame.height, 1), QImage::Format_ARGB32_Premultiplied);
+        
+        m_backingRegion = region;
+        m_backingLevel = frame.level;
+        patchBacking(frame, area);
+        
+        update();
+        return;
+    }
+    
+    if (region != m_backingRegion)
+    {
+        // panned, what both regions share moves over from the image before
+        // and only the strips newly in the region come from the frame
+        QImage backing(std::max(frame.width, 1), std::max(frame.height, 1), QImage::Format_ARGB32_Premultiplied);
+        const QRect overlap = region.intersected(m_backingRegion);
+        
+        for (int y = overlap.top(); y <= overlap.bottom(); ++y)
         {
-            qreal x = i * m_cellSize + startX;
-            painter->drawLine(x, startY, x, startY + m_rows * m_cellSize);
+            std::memcpy(reinterpret_cast<uint32_t*>(backing.scanLine(y - region.y())) + overlap.x() - region.x(),
+                        reinterpret_cast<const uint32_t*>(m_backing.constScanLine(y - m_backingRegion.y())) +
+                        overlap.x() - m_backingRegion.x(), overlap.width() * sizeof(uint32_t));
         }
         
-        for (int i = startRow; i <= endRow+1; ++i)
+        m_backing.swap(backing);
+        m_backingRegion = region;
+        
+        if (overlap.isEmpty())
+        {
+            refreshBacking(frame, area);
+        }
+        else
         {
-            qreal y = i * m_cellSize + startY;
-            painter->drawLine(startX, y, startX + m_cols * m_cellSize, y);
+            refreshBacking(frame, GOLBounds(area.x0, area.y0, area.x1, overlap.top() - 1));
+            refreshBacking(frame, GOLBounds(area.x0, overlap.bottom() + 1, area.x1, area.y1));
+            refreshBacking(frame, GOLBounds(area.x0, overlap.top(), overlap.left() - 1, overlap.bottom()));
+            refreshBacking(frame, GOLBounds(overlap.right() + 1, overlap.top(), area.x1, overlap.bottom()));
         }
     }
-    else
+    
+    const int level = frame.level;
+    
+    // the boxes are in cells, the region in blocks of the level
+    for (const GOLBounds& dirty : frame.dirty.boxes)
+        refreshBacking(frame, GOLBounds(dirty.x0 >> level, dirty.y0 >> level, dirty.x1 >> level, dirty.y1 >> level)
+                              .intersected(area));
+}
+
+void GOLScene::refreshBacking(const GOLFrame& frame, const GOLBounds& box)
+{
+    if (box.empty()) { return; }
+    
+    patchBacking(frame, box);
+    
+    const qreal startX = -m_cols * cellExtent() / 2.0;
+    const qreal startY = -m_rows * cellExtent() / 2.0;
+    const qreal extent = cellExtent() * (1 << frame.level);
+    
+    // with the grid line on the right and bottom
+    update(QRectF(startX + box.x0 * extent, startY + box.y0 * extent,
+                  box.width() * extent + 1, box.height() * extent + 1));
+}
+
+void GOLScene::patchBacking(const GOLFrame& frame, const GOLBounds& box)
+{
+    if (box.empty()) { return; }
+    
+    for (int y = box.y0; y <= box.y1; ++y)
     {
-        painter->drawRect(startX, startY, m_cols * m_cellSize, m_rows * m_cellSize);
+        std::memcpy(reinterpret_cast<uint32_t*>(m_backing.scanLine(y - frame.y)) + box.x0 - frame.x,
+                    &frame.pixels[(size_t)(y - frame.y) * frame.width + box.x0 - frame.x],
+                    box.width() * sizeof(uint32_t));
     }
 }
 
 
 void GOLScene::reset()
 {
-    std::lock_guard<std::mutex> guard(m_cellsMutex);
+    std::lock_guard<GOLTicketMutex> guard(m_cellsMutex);
     
-    std::memset(m_cells, false, sizeof(bool) * m_rows * m_cols);
+    m_engine->clear();
     m_tickCount = 0;
-    m_cellCounter = 0;
-    
-    emit aliveCellsSignal(0);
-    emit tickCountSignal(0);
+    m_rateTimer.invalidate();
+    resetDetector();
     
-    update();
+    m_changes.setAll();
+    requestFrame();
 }
 
 void GOLScene::save(const QString& path)
 {
-    std::lock_guard<std::mutex> guard(m_cellsMutex);
+    std::lock_guard<GOLTicketMutex> guard(m_cellsMutex);
     
-    QFile file(path);
-    if (file.open(QFile::WriteOnly))
-    {
-        QByteArray data;
-        QDataStream out(&data, QIODevice::WriteOnly);
-        out << m_rows << m_cols;
-        
-        for (int i = 0; i < m_rows * m_cols; ++i)
-            out << m_cells[i];
-        
-        file.write(data);
-        file.close();
-    }
+    std::vector<uint8_t> states((size_t)m_cols * m_rows);
+    m_engine->getStates(0, 0, m_cols, m_rows, states.data());
+    
+    GOLFile::saveStates(path, states.data(), m_cols, m_rows, m_engine->rule().states,
+                        QString::fromStdString(m_engine->rule().toString()));
 }
 
 void GOLScene::load(const QString& path)
 {
     int cols, rows;
-    bool* cells = loadFile(path, cols, rows);
+    QString ruleStr;
+    uint8_t* cells = GOLFile::loadStates(path, cols, rows, &ruleStr);
     
-    std::lock_guard<std::mutex> guard(m_cellsMutex);
+    std::lock_guard<GOLTicketMutex> guard(m_cellsMutex);
     
     if (cells)
     {
-        if (cols != m_cols || rows != m_rows)
+        GOLRule rule;
+        if (!ruleStr.isEmpty() && GOLRule::parse(ruleStr.toStdString(), rule))
         {
-            delete[] m_cells;
-            delete[] m_buffer;
+            if (!m_engine->supportsRule(rule))
+                switchEngine(GOLEngine::MultiState);
             
-            m_cells = new bool[cols * rows];
-            m_buffer = new bool[cols * rows];
-            
-            m_rows = rows;
-            m_cols = cols;
+            m_engine->setRule(rule);
+            emit ruleSignal(QString::fromStdString(rule.toString()));
         }
         
-        std::memcpy(m_cells, cells, sizeof(bool) * cols * rows);
+        m_engine->clear();
+        m_engine->setSize(cols, rows);
+        m_density.setSize(cols, rows);
+        m_engine->setStates(0, 0, cols, rows, cells);
+        delete[] cells;
+        
+        m_rows = rows;
+        m_cols = cols;
+        updateSceneRect();
         
         m_tickCount = 0;
-        emit tickCountSignal(0);
-        emit aliveCellsSignal(0);
-        m_cellCounter = 0;
+        m_rateTimer.invalidate();
+        resetDetector();
         
         emit pauseSignal(true);
         
         emit rowsSignal(m_rows);
         emit colsSignal(m_cols);
         
+        m_changes.setAll();
         update();
+        requestFrame();
     }
 }
 
 void GOLScene::insert(bool* cells, int x, int y, int cols, int rows)
 {
-    std::lock_guard<std::mutex> guard(m_cellsMutex);
+    std::lock_guard<GOLTicketMutex> guard(m_cellsMutex);
     
     if (cells)
     {
         if (x + cols > m_cols || y + rows > m_rows)
             setSize(std::max(m_cols, x + cols), std::max(m_rows, y + rows), false);
         
-        for (int i = 0; i < rows; ++i)
-            for (int j = 0; j < cols; ++j)
-                m_cells[(i+y) * m_cols + x+j] = cells[i * cols + j];
+        m_engine->setRegion(x, y, cols, rows, cells);
+        m_changes.add(GOLBounds(x, y, x + cols - 1, y + rows - 1));
+        resetDetector();
         
-        update();
+        requestFrame();
     }
 }
 
 
 void GOLScene::setSize(int cols, int rows, bool lock)
 {
-    std::shared_ptr<std::lock_guard<std::mutex>> guard;
+    std::shared_ptr<std::lock_guard<GOLTicketMutex>> guard;
     if (lock)
-        guard.reset(new std::lock_guard<std::mutex>(m_cellsMutex));
+        guard.reset(new std::lock_guard<GOLTicketMutex>(m_cellsMutex));
     
     if (cols == m_cols && rows == m_rows) { return; }
     
-    bool* ncells = new bool[cols * rows];
-    bool* nbuffer = new bool[cols * rows];
-    
-    std::memset(ncells, false, sizeof(bool) * rows * cols);
-    
-    if (cols == m_cols && rows != m_rows)
-    {
-        std::memcpy(ncells, m_cells, sizeof(bool) * cols * std::min(rows, m_rows));
-    }
-    else
-    {
-        #pragma omp parallel for num_threads(NUM_THREADS)
-        for (int y = 0; y < std::min(m_rows, rows); ++y)
-        {
-            for (int x = 0; x < std::min(m_cols, cols); ++x)
-            {
-                ncells[y * cols + x] = m_cells[y * m_cols + x];
-            }
-        }
-    }
-    
-    delete[] m_cells;
-    delete[] m_buffer;
-    m_cells = ncells;
-    m_buffer = nbuffer;
+    m_engine->setSize(cols, rows);
+    m_density.setSize(cols, rows);
     
     m_cols = cols;
     m_rows = rows;
+    updateSceneRect();
+    
+    resetDetector();
     
     colsSignal(cols);
     rowsSignal(rows);
     
+    // the board moves within the scene
+    m_changes.setAll();
     update();
+    requestFrame();
 }
 
 
 void GOLScene::chaos()
 {
-    std::lock_guard<std::mutex> guard(m_cellsMutex);
+    std::lock_guard<GOLTicketMutex> guard(m_cellsMutex);
     
     //std::random_device dev;
     std::mt19937 rng(time(0));
     std::normal_distribution<float> dist(0.0, 1.0);
     
+    bool* cells = new bool[m_cols * m_rows];
+    
     for (int i = 0; i < m_cols * m_rows; ++i)
-        m_cells[i] = dist(rng) > 0.5;
+        cells[i] = dist(rng) > 0.5;
+    
+    m_engine->setRegion(0, 0, m_cols, m_rows, cells);
+    delete[] cells;
+    
+    resetDetector();
+    
+    m_changes.setAll();
+    requestFrame();
+}
+
+
+void GOLScene::setCellSize(int size)
+{
+    rescale(size, m_zoomOut);
+}
+
+void GOLScene::setZoomOut(int level)
+{
+    rescale(m_cellSize, std::max(0, std::min(level, DENSITY_LEVELS)));
+}
+
+void GOLScene::rescale(int cellSize, int zoomOut)
+{
+    QGraphicsView* view = views().empty() ? NULL : views()[0];
+    
+    // the middle of the view in cells
+    QPointF centre;
+    if (view)
+    {
+        centre = view->mapToScene(view->viewport()->rect().center());
+        centre = QPointF(centre.x() / cellExtent() + m_cols / 2.0, centre.y() / cellExtent() + m_rows / 2.0);
+    }
+    
+    // both are only used on the GUI thread, no need to wait for the simulation
+    m_cellSize = cellSize;
+    m_zoomOut = zoomOut;
+    
+    updateSceneRect();
+    
+    if (view)
+        view->centerOn(QPointF((centre.x() - m_cols / 2.0) * cellExtent(), (centre.y() - m_rows / 2.0) * cellExtent()));
     
     update();
 }
 
+// the board and the grid line on its right and bottom, the view scrolls over it
+void GOLScene::updateSceneRect()
+{
+    const qreal width = m_cols * cellExtent();
+    const qreal height = m_rows * cellExtent();
+    
+    setSceneRect(-width / 2.0, -height / 2.0, width + 1, height + 1);
+}
+
 
 void GOLScene::fpsChanged(int fps)
 {
@@ -404,6 +1037,24 @@ void GOLScene::fpsChanged(int fps)
 void GOLScene::pauseChanged(bool pause)
 {
     m_paused.store(pause);
+    
+    // an uncapped run may have stopped on a generation that was not shown
+    if (pause)
+    {
+        requestFrame();
+        emit rateSignal(0.0);
+    }
+}
+
+void GOLScene::stopWhenSettledChanged(bool stop)
+{
+    m_stopWhenSettled.store(stop);
+}
+
+void GOLScene::uncappedChanged(bool uncapped)
+{
+    m_uncapped.store(uncapped);
+    m_thread->wake();
 }
 
 
@@ -411,14 +1062,14 @@ QPoint GOLScene::sceneToCellCoords(const QPointF& scenepos)
 {
     QPoint cell;
     
-    qreal width = m_cols * m_cellSize;
-    qreal height = m_rows * m_cellSize;
+    qreal width = m_cols * cellExtent();
+    qreal height = m_rows * cellExtent();
     
     qreal startX = -width / 2.0;
     qreal startY = -height / 2.0;
     
-    cell.setX((scenepos.x() - startX) / m_cellSize);
-    cell.setY((scenepos.y() - startY) / m_cellSize);
+    cell.setX((scenepos.x() - startX) / cellExtent());
+    cell.setY((scenepos.y() - startY) / cellExtent());
     
     return cell;
 }
@@ -431,183 +1082,29 @@ bool GOLScene::inGrid(const QPoint& cell)
 
 bool* GOLScene::copyCells()
 {
-    std::lock_guard<std::mutex> guard(m_cellsMutex);
+    std::lock_guard<GOLTicketMutex> guard(m_cellsMutex);
     
     bool* ncells = new bool[m_cols * m_rows];
-    std::memcpy(ncells, m_cells, sizeof(bool) * m_cols * m_rows);
+    m_engine->getRegion(0, 0, m_cols, m_rows, ncells);
     return ncells;
 }
 
 void GOLScene::setCells(bool* cells, int cols, int rows)
 {
-    std::lock_guard<std::mutex> guard(m_cellsMutex);
+    std::lock_guard<GOLTicketMutex> guard(m_cellsMutex);
     
-    delete[] m_cells;
-    m_cells = cells;
+    m_engine->clear();
+    m_engine->setSize(cols, rows);
+    m_density.setSize(cols, rows);
+    m_engine->setRegion(0, 0, cols, rows, cells);
+    delete[] cells;
     
-    if (cols != m_cols || rows != m_rows)
-    {
-        delete[] m_buffer;
-        m_buffer = new bool[cols * rows];
-        
-        m_cols = cols;
-        m_rows = rows;
-    }
-}
-
-
-bool* GOLScene::loadFile(const QString& path, int& cols, int& rows)
-{
-    bool* cells = NULL;
-    
-    QFile file(path);
-    if (file.open(QFile::ReadOnly))
-    {
-        if (path.toLower().endsWith(".gol"))
-        {
-            QByteArray data = file.readAll();
-            QDataStream in(&data, QIODevice::ReadOnly);
-            
-            in >> rows >> cols;
-            
-            cells = new bool[cols * rows];
-            
-            for (int i = 0; i < cols * rows; ++i)
-                in >> cells[i];
-        }
-        else if (path.toLower().endsWith(".rle"))
-        {
-            QByteArray data = file.readAll();
-            QTextStream in(&data, QIODevice::ReadOnly);
-            
-            bool header = false;
-            int x = 0, y = 0, count = 1;
-            QString countStr = "";
-            bool endMarker = false;
-            
-            while (!in.atEnd() && !endMarker)
-            {
-                QString line = in.readLine().trimmed();
-                if (line.isEmpty() || line.startsWith('#')) { continue; }
-                
-                if (!header && line.startsWith("x"))
-                {
-                    QString str = line.left(line.indexOf(","));
-                    cols = str.right(str.size() - str.indexOf("=") - 1).trimmed().toInt();
-                    str = line.right(line.size() - str.size() - 1);
-                    str = str.left(str.indexOf(","));
-                    rows = str.right(str.size() - str.indexOf("=") - 1).trimmed().toInt();
-                    header = true;
-                    
-                    cells = new bool[cols * rows];
-                    memset(cells, false, sizeof(bool)*cols*rows);
-                }
-                else
-                {
-                    for (int i = 0; i < line.size(); ++i)
-                    {
-                        QChar c = line[i];
-                        
-                        if (c == 'b' || c == 'o' || c == '$')
-                        {
-                            if (!countStr.isEmpty())
-                            {
-                                count = countStr.toInt();
-                                countStr = "";
-                            }
-                            for (int j = 0; j < count; ++j)
-                            {
-                                if (c == '$')
-                                {
-                                    x = 0;
-                                    ++y;
-                                    if (y >= rows)
-                                    {
-                                        i = line.size();
-                                        endMarker = true;
-                                    }
-                                }
-                                else
-                                {
-                                    if (x >= cols)
-                                    {
-                                        ++y;
-                                        x = 0;
-                                    }
-                                    cells[y * cols + x] = (c == 'o');
-                                    ++x;
-                                    if (y >= rows)
-                                    {
-                                        i = line.size();
-                                        endMarker = true;
-                                    }
-                                }
-                            }
-                            count = 1;
-                        }
-                        else if (c.isDigit())
-                        {
-                            countStr += c;
-                        }
-                        else if (c == '!')
-                        {
-                            endMarker = true;
-                            break;
-                        }
-                    }
-                }
-            }
-        }
-        
-        file.close();
-    }
-    
-    return cells;
-}
-
-
-bool* GOLScene::rotateCells(bool* cells, int& cols, int& rows, int rotation)
-{
-    rotation = rotation % 4;
-    if (rotation <= 0) { return cells; }
-    
-    int ncols = cols, nrows = rows;
-    
-    if (rotation == 1 || rotation == 3)
-    {
-        ncols = rows; nrows = cols;
-    }
-    
-    bool* ncells = new bool[ncols * nrows];
-    
-    auto f = [&](int x, int y) -> int
-    {
-        int nx, ny;
-        
-        if (rotation == 1)
-        {
-            nx = ncols - y - 1;
-            ny = x;
-        }
-        else if (rotation == 2)
-        {
-            nx = ncols - x - 1;
-            ny = nrows - y - 1;
-        }
-        else if (rotation == 3)
-        {
-            nx = y;
-            ny = nrows - x - 1;
-        }
-        
-        return ny * ncols + nx;
-    };
+    m_cols = cols;
+    m_rows = rows;
+    updateSceneRect();
     
-    for (int y = 0; y < rows; ++y)
-        for (int x = 0; x < cols; ++x)
-            ncells[f(x,y)] = cells[y * cols + x];
+    resetDetector();
     
-    rows = nrows;
-    cols = ncols;
-    return ncells;
+    m_changes.setAll();
+    requestFrame();
 }
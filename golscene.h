@@ -8,11 +8,29 @@
 #define GRID_HEIGHT 20
 #define CELL_SIZE   32
 #define START_FPS   10
-#define NUM_THREADS  4
 
+#define DISPLAY_HZ     60   // uncapped: generations shown per second
+#define RATE_INTERVAL 500   // ms between two generations/s measurements
+
+#define ADVANCE_REPORT_MS 100  // progress of advance(), also when it lets waiting threads in
+
+#define VIEW_MARGIN  32  // cells or blocks requested around the visible ones, for panning
+
+
+#include "golengine.h"
+#include "golframebuffer.h"
+#include "golthreadpool.h"
+#include "goleditqueue.h"
+#include "golticketmutex.h"
+#include "golperiod.h"
+#include "golprofiler.h"
+#include "goldensity.h"
 
 #include <QObject>
 #include <QGraphicsScene>
+#include <QElapsedTimer>
+#include <QPixmap>
+#include <QImage>
 
 #include <vector>
 #include <memory>
@@ -22,6 +40,7 @@
 
 
 class GOLThread;
+class GOLRenderThread;
 class QHoverEvent;
 class QGraphicsMouseEvent;
 
@@ -31,6 +50,7 @@ class GOLScene : public QGraphicsScene
     Q_OBJECT
     
     friend class GOLThread;
+    friend class GOLRenderThread;
     
 public:
     
@@ -40,24 +60,46 @@ public:
     
     inline bool paused() { return m_paused.load(); }
     inline int fps() { return m_fps.load(); }
+    inline bool uncapped() { return m_uncapped.load(); }
+    inline bool advancePending() { return m_advance.load() != 0; }
     
+    // of the latest frame, GUI thread only
+    const GOLStats& stats() { return m_rendered.front().stats; }
+    
+    // zoomed out, a pixel shows a block of 2^zoomOut() x 2^zoomOut() cells and
+    // the cell size is ignored; GUI thread only
+    inline int zoomOut() { return m_zoomOut; }
+    void setZoomOut(int level);
+    
+    // GUI thread only
     inline int cellSize() { return m_cellSize; }
-    inline void setCellSize(int size)
-    { 
-        std::lock_guard<std::mutex> g(m_cellsMutex);
-        m_cellSize = size;
-    }
+    void setCellSize(int size);
     
     void tick();
     
+    // runs the generations back to back on the simulation thread, in leaps as
+    // large as the engine can take (powers of two for HashLife)
+    void advance(quint64 generations);
+    void cancelAdvance();
+    
+    GOLEngine::Type engineType();
+    void setEngineType(GOLEngine::Type type);
+    int stepExponent();
+    void setStepExponent(int exponent);
+    bool wraps();
+    void setWrap(bool wrap);
+    
+    // replaces the pool the engines step on, 0 threads for one per core; the
+    // board keeps the memory placement of its first touch until it is resized
+    void setThreads(int threads, GOLThreadPool::Placement placement);
+    GOLRule rule();
+    void setRule(const GOLRule& rule);
+    
     void reset();
     void save(const QString& path);
     void load(const QString& path);
     void insert(bool* cells, int x, int y, int cols, int rows);
     
-    static bool* loadFile(const QString& path, int& cols, int& rows);
-    static bool* rotateCells(bool* cells, int& cols, int& rows, int rotation);
-    
     int rows() { return m_rows; }
     void setRows(int rows) { setSize(m_cols, rows); }
     int columns() { return m_cols; }
@@ -70,8 +112,9 @@ public:
     bool* copyCells();
     void setCells(bool* cells, int cols, int rows); // takes ownership of the pointer
     
-    std::mutex& _cellsMutex() { return m_cellsMutex; }
-    const bool* cells() { return m_cells; }
+    GOLTicketMutex& _cellsMutex() { return m_cellsMutex; }
+    GOLProfiler& profiler() { return m_profiler; }
+    const GOLEngine* engine() { return m_engine; }
     
     
     
@@ -88,16 +131,29 @@ public slots:
     
     void fpsChanged(int fps);
     void pauseChanged(bool pause);
+    void uncappedChanged(bool uncapped);
+    void stopWhenSettledChanged(bool stop);
+    
+    
+private slots:
+    
+    void frameArrived(qint64 published);
     
     
 signals:
     
-    void aliveCellsSignal(int count);
-    void tickCountSignal(int count);
+    void statsSignal(); // with every frame, read them with stats()
     void pauseSignal(bool paused);
     void rowsSignal(int rows);
     void colsSignal(int cols);
     void cursorSignal(int col, int row);
+    void ruleSignal(const QString& rule);
+    void engineSignal(int type);
+    void frameSignal(qint64 published); // GOLProfiler::now()
+    void rateSignal(double generationsPerSecond);
+    void advanceSignal(qint64 done, qint64 total);
+    void advanceDoneSignal(qint64 done);
+    void settledSignal(int state, qint64 period); // GOLPeriodDetector::State
     
     
 private:
@@ -105,26 +161,86 @@ private:
     // Methods:
     
     QPoint sceneToCellCoords(const QPointF& scenepos);
+    inline qreal cellExtent() { return m_zoomOut ? 1.0 / (1 << m_zoomOut) : m_cellSize; } // in the scene
+    
+    void rescale(int cellSize, int zoomOut); // keeps the cell in the middle of the view there
+    void updateSceneRect();
     bool inGrid(const QPoint& cell);
     
+    void switchEngine(GOLEngine::Type type); // m_cellsMutex has to be held
+    
+    void edit(const QPoint& cell, bool alive);
+    void requestFrame();
+    
+    // simulation thread
+    void serviceRequests();
+    void applyEdits();   // m_cellsMutex has to be held
+    void runAdvance();   // m_cellsMutex has to be held
+    bool detectSettled(); // m_cellsMutex has to be held
+    void resetDetector(); // m_cellsMutex has to be held
+    void noteChanges(const GOLBounds& before, bool oneStep); // m_cellsMutex has to be held
+    void publishFrame(); // m_cellsMutex has to be held
+    
+    // render thread
+    void renderFrame();
+    void expandPixels(GOLFrame& frame);
+    
+    // GUI thread
+    void patchBacking(const GOLFrame& frame, const GOLBounds& box);
+    void refreshBacking(const GOLFrame& frame, const GOLBounds& box); // and repaints it
+    
     
     // Attributes:
     
-    int m_rows, m_cols, m_cellSize;
-    bool *m_cells, *m_buffer;
+    int m_rows, m_cols, m_cellSize, m_zoomOut;
+    GOLEngine* m_engine;
     
-    std::atomic_bool m_paused;
+    std::atomic_bool m_paused, m_uncapped, m_stopWhenSettled;
     std::atomic_int m_fps;
     
-    unsigned long m_tickCount, m_cellCounter;
+    quint64 m_tickCount;
     
-    std::mutex m_cellsMutex;
+    QElapsedTimer m_displayTimer, m_rateTimer;
+    quint64 m_rateTicks; // m_tickCount when m_rateTimer started
+    
+    GOLPeriodDetector m_detector;
+    
+    GOLProfiler m_profiler;
+    GOLTicketMutex m_cellsMutex;
+    
+    // the simulation publishes the cells of a region into m_frames, the
+    // render thread adds their pixels and publishes them into m_rendered for
+    // the GUI thread
+    GOLFrameBuffer m_frames, m_rendered;
+    std::vector<uint8_t> m_frameCells; // the living part of a frame
+    std::vector<uint32_t> m_palette;   // pixel of each state, render thread only
+    GOLDirtyRegion m_changes;          // since the last frame published
+    GOLDirtyRegion m_untaken;          // of the frames the render thread may not have taken
+    GOLDirtyRegion m_renderedUntaken;  // of the rendered ones the GUI thread may not have taken
+    std::vector<GOLBounds> m_changedBoxes;
+    GOLDensityPyramid m_density;       // of the frames zoomed out
+    GOLEditQueue m_edits;
+    std::atomic_bool m_frameRequested;
+    
+    std::atomic<quint64> m_advance; // generations requested, 0 if none
+    std::atomic_bool m_cancelAdvance;
     
     GOLThread* m_thread;
+    GOLRenderThread* m_renderThread;
+    
+    
+    bool m_drawing, m_drawKill, m_panning;
+    QPoint m_lastDrawCell, m_lastHoverCursor, m_lastPanPos;
     
+    QPixmap m_gridTile; // one cell of the grid lines, GUI thread only
     
-    bool m_drawing, m_drawKill;
-    QPoint m_lastDrawCell, m_lastHoverCursor;
+    // the pixels of the region of the frame taken last, only the dirty boxes
+    // of the next one are copied into it; GUI thread only
+    QImage m_backing;
+    QRect m_backingRegion; // in blocks of the level, cells at 0
+    int m_backingLevel;
+    QRect m_requestedRegion; // the visible blocks and VIEW_MARGIN around them
+    int m_requestedLevel;
     
     
 };
@@ -0,0 +1,435 @@
+#include "golsparseengine.h"
+#include "golkernels.h"
+#include "golthreadpool.h"
+#include "goltrace.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+static const int s_dx[8] = { -1, 0, 1, -1, 1, -1, 0, 1 };
+static const int s_dy[8] = { -1, -1, -1, 0, 0, 1, 1, 1 };
+
+
+GOLSparseEngine::GOLSparseEngine(int cols, int rows)
+ : GOLEngine(cols, rows)
+ , m_current(0)
+ , m_population(0)
+ , m_activeChunks(0)
+ , m_hash(0)
+{
+}
+
+GOLSparseEngine::~GOLSparseEngine()
+{
+    clear();
+}
+
+
+void GOLSparseEngine::setSize(int cols, int rows)
+{
+    // the board is only a window, the plane itself has no size
+    m_cols = cols;
+    m_rows = rows;
+    
+    m_bounds = GOLBounds();
+    for (auto& entry : m_chunks)
+        m_bounds.extend(boardBounds(entry.second));
+}
+
+void GOLSparseEngine::clear()
+{
+    for (auto& entry : m_chunks)
+        delete entry.second;
+    
+    m_chunks.clear();
+    m_population = 0;
+    m_activeChunks = 0;
+    m_hash = 0;
+    m_bounds = GOLBounds();
+}
+
+
+bool GOLSparseEngine::get(int x, int y) const
+{
+    Chunk* c = find(x >> 6, y >> 6);
+    
+    return c && (c->cells[m_current][y & 63] >> (x & 63)) & 1;
+}
+
+void GOLSparseEngine::set(int x, int y, bool alive)
+{
+    Chunk* c = alive ? chunk(x >> 6, y >> 6) : find(x >> 6, y >> 6);
+    
+    if (!c) { return; }
+    
+    uint64_t& word = c->cells[m_current][y & 63];
+    uint64_t bit = (uint64_t)1 << (x & 63);
+    
+    if (((word & bit) != 0) == alive) { return; }
+    
+    word ^= bit;
+    
+    if (alive) { ++c->population; ++m_population; }
+    else       { --c->population; --m_population; }
+    
+    if (alive)
+    {
+        c->box.extend(x & 63, y & 63);
+        m_bounds.extend(x, y);
+    }
+    
+    c->changed = true;
+}
+
+void GOLSparseEngine::getRegion(int x, int y, int w, int h, bool* cells) const
+{
+    for (int i = 0; i < h; ++i)
+    {
+        int cy = (y + i) >> 6, row = (y + i) & 63;
+        
+        for (int j = 0; j < w;)
+        {
+            int bit = (x + j) & 63;
+            int n = std::min(64 - bit, w - j);
+            bool* out = cells + i * w + j;
+            
+            if (Chunk* c = find((x + j) >> 6, cy))
+            {
+                uint64_t word = c->cells[m_current][row] >> bit;
+                
+                for (int k = 0; k < n; ++k)
+                    out[k] = (word >> k) & 1;
+            }
+            else
+                std::fill(out, out + n, false);
+            
+            j += n;
+        }
+    }
+}
+
+void GOLSparseEngine::setRegion(int x, int y, int w, int h, const bool* cells)
+{
+    for (int i = 0; i < h; ++i)
+    {
+        int cy = (y + i) >> 6, row = (y + i) & 63;
+        
+        for (int j = 0; j < w;)
+        {
+            int bit = (x + j) & 63;
+            int n = std::min(64 - bit, w - j);
+            const bool* in = cells + i * w + j;
+            
+            uint64_t bits = 0;
+            for (int k = 0; k < n; ++k)
+                bits |= (uint64_t)in[k] << (bit + k);
+            
+            Chunk* c = bits ? chunk((x + j) >> 6, cy) : find((x + j) >> 6, cy);
+            
+            if (c)
+            {
+                uint64_t mask = (n == 64) ? ~(uint64_t)0 : (((uint64_t)1 << n) - 1) << bit;
+                uint64_t& word = c->cells[m_current][row];
+                uint64_t old = word;
+                
+                word = (word & ~mask) | bits;
+                
+                if (uint64_t born = word & ~old)
+                {
+                    GOLBounds box(__builtin_ctzll(born), row, 63 - __builtin_clzll(born), row);
+                    
+                    c->box.extend(box);
+                    m_bounds.extend(GOLBounds(x + j - bit + box.x0, y + i, x + j - bit + box.x1, y + i));
+                }
+                
+                if (word != old)
+                {
+                    c->population += __builtin_popcountll(word) - __builtin_popcountll(old);
+                    m_population += __builtin_popcountll(word) - __builtin_popcountll(old);
+                    c->changed = true;
+                }
+            }
+            
+            j += n;
+        }
+    }
+}
+
+
+void GOLSparseEngine::setRule(const GOLRule& rule)
+{
+    GOLEngine::setRule(rule);
+    
+    for (auto& entry : m_chunks)
+        entry.second->changed = true;
+}
+
+
+void GOLSparseEngine::step()
+{
+    m_list.clear();
+    for (auto& entry : m_chunks)
+    {
+        entry.second->needed = false;
+        m_list.push_back(entry.second);
+    }
+    
+    // every living chunk is kept and so is each neighbour its border cells
+    // reach into, missing ones are created empty
+    for (Chunk* c : m_list)
+    {
+        if (!c->population) { continue; }
+        
+        const uint64_t* cells = c->cells[m_current];
+        const uint64_t top = cells[0], bottom = cells[SPARSE_CHUNK_SIZE - 1];
+        
+        uint64_t any = 0;
+        for (int i = 0; i < SPARSE_CHUNK_SIZE; ++i)
+            any |= cells[i];
+        
+        const bool edge[8] = { (top & 1) != 0,    top != 0,    (top >> 63) != 0,
+                               (any & 1) != 0,                 (any >> 63) != 0,
+                               (bottom & 1) != 0, bottom != 0, (bottom >> 63) != 0 };
+        
+        c->needed = true;
+        
+        for (int d = 0; d < 8; ++d)
+        {
+            if (edge[d])
+                chunk(c->x + s_dx[d], c->y + s_dy[d])->needed = true;
+        }
+    }
+    
+    // a chunk is recomputed if it or a neighbour changed, this has to be
+    // decided before empty chunks and their changed flags are dropped
+    for (auto& entry : m_chunks)
+        link(entry.second);
+    
+    for (auto& entry : m_chunks)
+    {
+        Chunk* c = entry.second;
+        
+        c->active = c->changed;
+        for (int d = 0; d < 8; ++d)
+            c->active |= c->neighbours[d] && c->neighbours[d]->changed;
+    }
+    
+    m_list.clear();
+    for (auto it = m_chunks.begin(); it != m_chunks.end();)
+    {
+        if (!it->second->needed)
+        {
+            delete it->second;
+            it = m_chunks.erase(it);
+        }
+        else
+        {
+            if (it->second->active)
+                m_list.push_back(it->second);
+            
+            ++it;
+        }
+    }
+    
+    for (Chunk* c : m_list)
+        link(c);
+    
+    const int count = (int)m_list.size();
+    
+    GOLThreadPool::instance().run(count, [this](int i)
+    {
+        GOLTraceScope scope("chunk", m_list[i]->x, m_list[i]->y);
+        tick(m_list[i]);
+    });
+    
+    m_current ^= 1;
+    
+    m_population = 0;
+    m_hash = 0;
+    m_bounds = GOLBounds();
+    for (auto& entry : m_chunks)
+    {
+        m_population += entry.second->population;
+        m_hash += entry.second->hash;
+        m_bounds.extend(boardBounds(entry.second));
+    }
+    
+    m_activeChunks = count;
+}
+
+// the chunks across the edge of the board are counted row by row
+uint64_t GOLSparseEngine::boardPopulation() const
+{
+    const GOLBounds board(0, 0, m_cols - 1, m_rows - 1);
+    uint64_t population = 0;
+    
+    for (auto& entry : m_chunks)
+    {
+        const Chunk* c = entry.second;
+        if (!c->population) { continue; }
+        
+        const int cx = c->x * SPARSE_CHUNK_SIZE, cy = c->y * SPARSE_CHUNK_SIZE;
+        const GOLBounds box(cx, cy, cx + SPARSE_CHUNK_SIZE - 1, cy + SPARSE_CHUNK_SIZE - 1);
+        const GOLBounds clipped = box.intersected(board);
+        
+        if (clipped.empty()) { continue; }
+        
+        if (clipped.x0 == box.x0 && clipped.y0 == box.y0 && clipped.x1 == box.x1 && clipped.y1 == box.y1)
+        {
+            population += c->population;
+            continue;
+        }
+        
+        const uint64_t mask = (~(uint64_t)0 >> (63 - (clipped.x1 - cx))) & (~(uint64_t)0 << (clipped.x0 - cx));
+        
+        for (int y = clipped.y0; y <= clipped.y1; ++y)
+            population += __builtin_popcountll(c->cells[m_current][y - cy] & mask);
+    }
+    
+    return population;
+}
+
+
+bool GOLSparseEngine::changedRegions(std::vector<GOLBounds>& boxes) const
+{
+    const GOLBounds board(0, 0, m_cols - 1, m_rows - 1);
+    
+    for (auto& entry : m_chunks)
+    {
+        const Chunk* c = entry.second;
+        if (!c->changed) { continue; }
+        
+        const int cx = c->x * SPARSE_CHUNK_SIZE, cy = c->y * SPARSE_CHUNK_SIZE;
+        const GOLBounds box = GOLBounds(cx, cy, cx + SPARSE_CHUNK_SIZE - 1, cy + SPARSE_CHUNK_SIZE - 1).intersected(board);
+        
+        if (!box.empty())
+            boxes.push_back(box);
+    }
+    
+    return true;
+}
+
+
+GOLSparseEngine::Chunk* GOLSparseEngine::find(int cx, int cy) const
+{
+    auto it = m_chunks.find(key(cx, cy));
+    
+    return it == m_chunks.end() ? nullptr : it->second;
+}
+
+GOLSparseEngine::Chunk* GOLSparseEngine::chunk(int cx, int cy)
+{
+    Chunk*& c = m_chunks[key(cx, cy)];
+    
+    if (!c)
+    {
+        c = new Chunk;
+        std::memset(c->cells, 0, sizeof(c->cells));
+        std::fill(c->neighbours, c->neighbours + 8, nullptr);
+        c->x = cx;
+        c->y = cy;
+        c->population = 0;
+        c->hash = 0;
+        c->box = GOLBounds();
+        c->changed = true;
+        c->needed = true;
+        c->active = true;
+    }
+    
+    return c;
+}
+
+
+void GOLSparseEngine::link(Chunk* c)
+{
+    for (int d = 0; d < 8; ++d)
+        c->neighbours[d] = find(c->x + s_dx[d], c->y + s_dy[d]);
+}
+
+// next generation of a chunk into its back buffer, the row kernel runs on
+// one word with the neighbouring words (or zeros) as its halo
+void GOLSparseEngine::tick(Chunk* c)
+{
+    const int last = SPARSE_CHUNK_SIZE - 1;
+    
+    Chunk* const* n = c->neighbours;
+    const uint64_t* cells = c->cells[m_current];
+    uint64_t* out = c->cells[m_current ^ 1];
+    
+    uint64_t rows[SPARSE_CHUNK_SIZE + 2][3];
+    
+    rows[0][0] = n[NW] ? n[NW]->cells[m_current][last] : 0;
+    rows[0][1] = n[N]  ? n[N]->cells[m_current][last]  : 0;
+    rows[0][2] = n[NE] ? n[NE]->cells[m_current][last] : 0;
+    
+    for (int i = 0; i < SPARSE_CHUNK_SIZE; ++i)
+    {
+        rows[i+1][0] = n[W] ? n[W]->cells[m_current][i] : 0;
+        rows[i+1][1] = cells[i];
+        rows[i+1][2] = n[E] ? n[E]->cells[m_current][i] : 0;
+    }
+    
+    rows[last+2][0] = n[SW] ? n[SW]->cells[m_current][0] : 0;
+    rows[last+2][1] = n[S]  ? n[S]->cells[m_current][0]  : 0;
+    rows[last+2][2] = n[SE] ? n[SE]->cells[m_current][0] : 0;
+    
+    const GOLRowKernel tickRow = GOLKernels::tickRow(m_rule);
+    uint64_t population = 0, diff = 0, hash = 0, columns = 0;
+    int top = SPARSE_CHUNK_SIZE, bottom = -1;
+    
+    // rows of the plane, a row of chunks apart horizontally
+    const uint64_t position = ((uint64_t)(uint32_t)(c->y * SPARSE_CHUNK_SIZE) << 32) + (uint32_t)c->x;
+    
+    for (int i = 0; i < SPARSE_CHUNK_SIZE; ++i)
+    {
+        tickRow(rows[i] + 1, rows[i+1] + 1, rows[i+2] + 1, out + i, 1, m_rule);
+        
+        population += __builtin_popcountll(out[i]);
+        diff |= out[i] ^ cells[i];
+        hash += hashWord(out[i], position + ((uint64_t)i << 32));
+        
+        if (out[i])
+        {
+            columns |= out[i];
+            top = std::min(top, i);
+            bottom = i;
+        }
+    }
+    
+    c->box = columns ? GOLBounds(__builtin_ctzll(columns), top, 63 - __builtin_clzll(columns), bottom)
+                     : GOLBounds();
+    c->population = population;
+    c->hash = hash;
+    c->changed = diff != 0;
+}
+
+// living cells of a chunk within the board, in board coordinates
+GOLBounds GOLSparseEngine::boardBounds(const Chunk* c) const
+{
+    const int cx = c->x * SPARSE_CHUNK_SIZE, cy = c->y * SPARSE_CHUNK_SIZE;
+    const GOLBounds board(0, 0, m_cols - 1, m_rows - 1);
+    
+    if (c->box.empty()) { return GOLBounds(); }
+    
+    GOLBounds box(cx + c->box.x0, cy + c->box.y0, cx + c->box.x1, cy + c->box.y1);
+    GOLBounds clipped = box.intersected(board);
+    
+    if (clipped.empty() || (clipped.x0 == box.x0 && clipped.y0 == box.y0 && 
+                            clipped.x1 == box.x1 && clipped.y1 == box.y1))
+        return clipped;
+    
+    // across the edge of the board, only the cells on it count
+    const uint64_t mask = (~(uint64_t)0 >> (63 - (clipped.x1 - cx))) & (~(uint64_t)0 << (clipped.x0 - cx));
+    
+    GOLBounds bounds;
+    for (int y = clipped.y0; y <= clipped.y1; ++y)
+    {
+        uint64_t word = c->cells[m_current][y - cy] & mask;
+        
+        if (word)
+            bounds.extend(GOLBounds(cx + __builtin_ctzll(word), y, cx + 63 - __builtin_clzll(word), y));
+    }
+    
+    return bounds;
+}
@@ -0,0 +1,101 @@
+#ifndef GOLSPARSEENGINE_H
+#define GOLSPARSEENGINE_H
+
+
+#define SPARSE_CHUNK_SIZE  64 // cells per side, a chunk row is one word
+
+
+#include "golengine.h"
+
+#include <unordered_map>
+#include <vector>
+
+
+// Infinite plane stored as a hash map of 64x64 cell chunks. A chunk is
+// created when a living cell touches its border and freed once it is empty
+// and no neighbour reaches into it, so memory follows the living area instead
+// of its bounding box. The board is a window onto the plane at the origin.
+//
+// Chunks are double buffered and skipped like the tiles of GOLGridEngine when
+// neither they nor a neighbour changed in the last generation.
+
+class GOLSparseEngine : public GOLEngine
+{
+public:
+    
+    GOLSparseEngine(int cols, int rows);
+    virtual ~GOLSparseEngine();
+    
+    
+    virtual Type type() const override { return Sparse; }
+    
+    virtual void setSize(int cols, int rows) override;
+    virtual void clear() override;
+    
+    virtual bool get(int x, int y) const override;
+    virtual void set(int x, int y, bool alive) override;
+    
+    virtual void getRegion(int x, int y, int w, int h, bool* cells) const override;
+    virtual void setRegion(int x, int y, int w, int h, const bool* cells) override;
+    
+    virtual void setRule(const GOLRule& rule) override;
+    
+    virtual void step() override;
+    
+    // of the whole plane, the bounds of the board only
+    virtual uint64_t population() const override { return m_population; }
+    virtual uint64_t boardPopulation() const override;
+    virtual GOLBounds bounds() const override { return m_bounds; }
+    
+    virtual uint64_t activeTiles() const override { return m_activeChunks; }
+    virtual uint64_t tileCount() const override { return m_chunks.size(); }
+    virtual bool changedRegions(std::vector<GOLBounds>& boxes) const override;
+    
+    virtual uint64_t hash() const override { return m_hash; }
+    
+    
+private:
+    
+    // neighbour order, opposite directions are 7 - i apart
+    enum Direction { NW, N, NE, W, E, SW, S, SE };
+    
+    struct Chunk
+    {
+        uint64_t cells[2][SPARSE_CHUNK_SIZE];
+        Chunk* neighbours[8];
+        int x, y;
+        uint64_t population, hash;
+        GOLBounds box; // of the living cells, within the chunk
+        bool changed, needed, active;
+    };
+    
+    
+    // Methods:
+    
+    static inline uint64_t key(int cx, int cy)
+    {
+        return ((uint64_t)(uint32_t)cx << 32) | (uint32_t)cy;
+    }
+    
+    Chunk* find(int cx, int cy) const;
+    Chunk* chunk(int cx, int cy); // creates missing chunks
+    
+    void link(Chunk* c);
+    void tick(Chunk* c);
+    
+    GOLBounds boardBounds(const Chunk* c) const;
+    
+    
+    // Attributes:
+    
+    std::unordered_map<uint64_t, Chunk*> m_chunks;
+    std::vector<Chunk*> m_list;
+    
+    int m_current; // index of the live buffer in Chunk::cells
+    
+    uint64_t m_population, m_activeChunks, m_hash;
+    GOLBounds m_bounds;
+    
+};
+
+#endif // GOLSPARSEENGINE_H
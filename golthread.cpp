@@ -1,13 +1,15 @@
 #include "golthread.h"
 #include "golscene.h"
+#include "goltrace.h"
 
 #include <mutex>
-
+#include <chrono>
 
 
 GOLThread::GOLThread(GOLScene* scene, QObject *parent)
   : QThread(parent)
   , m_scene(scene)
+  , m_woken(false)
 {
     m_run.store(true);
     m_lastFps = m_scene->fps();
@@ -21,6 +23,8 @@ GOLThread::~GOLThread()
 
 void GOLThread::run()
 {
+    GOLTrace::setThreadName("simulation");
+    
     while (m_run.load())
     {
         long delta;
@@ -31,16 +35,67 @@ void GOLThread::run()
         else { delta = 0; }
         m_timer.start();
         
+        // an advance takes the place of the tick
+        if (m_scene->advancePending())
+        {
+            m_tickTimer.invalidate();
+            m_scene->serviceRequests();
+            continue;
+        }
+        
         if (!m_scene->paused())
         {
+            if (m_tickTimer.isValid())
+                m_scene->profiler().record(GOLProfiler::TickInterval, m_tickTimer.nsecsElapsed());
+            m_tickTimer.start();
+            
             m_scene->tick();
         }
+        else
+        {
+            m_tickTimer.invalidate();
+            m_scene->serviceRequests();
+        }
+        
+        // uncapped: straight on to the next generation, the scene shows only
+        // some of them
+        if (m_scene->uncapped() && !m_scene->paused()) { continue; }
         
         long add = (delta != 0) ? (long)((1000.0 / std::max(m_lastFps, 1)) * 1000.0) - delta - (m_timer.nsecsElapsed() / 1000) : 0;
         
         m_lastFps = m_scene->fps();
         long wait = (long)((1000.0 / std::max(m_lastFps, 1)) * 1000.0);
         
-        QThread::usleep(std::max((long)0, std::min(wait + add, wait * 2)));
+        idle(std::max((long)0, std::min(wait + add, wait * 2)));
+    }
+}
+
+
+void GOLThread::wake()
+{
+    {
+        std::lock_guard<std::mutex> guard(m_wakeMutex);
+        m_woken = true;
+    }
+    
+    m_wake.notify_one();
+}
+
+// sleeps until the next tick is due, serving the scene whenever woken up
+void GOLThread::idle(long usecs)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(usecs);
+    
+    std::unique_lock<std::mutex> lock(m_wakeMutex);
+    
+    while (m_run.load())
+    {
+        if (!m_wake.wait_until(lock, deadline, [this] { return m_woken; })) { break; }
+        
+        m_woken = false;
+        
+        lock.unlock();
+        m_scene->serviceRequests();
+        lock.lock();
     }
 }
@@ -10,6 +10,7 @@
 
 #include <atomic>
 #include <mutex>
+#include <condition_variable>
 
 
 class GOLScene;
@@ -24,7 +25,9 @@ public:
     virtual ~GOLThread();
     
     
-    inline void setRun(bool run) { m_run.store(run); }
+    inline void setRun(bool run) { m_run.store(run); wake(); }
+    
+    void wake(); // serves edits and frame requests of the scene without waiting for the next tick
     
     
 protected:
@@ -40,12 +43,20 @@ public slots:
     
 private:
     
+    void idle(long usecs);
+    
+    
     std::atomic<bool> m_run;
     
+    std::mutex m_wakeMutex;
+    std::condition_variable m_wake;
+    bool m_woken;
+    
     GOLScene* m_scene;
     
     int m_lastFps;
     QElapsedTimer m_timer;
+    QElapsedTimer m_tickTimer; // since the last tick, for the achieved rate
     
 };
 
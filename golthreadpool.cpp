@@ -0,0 +1,375 @@
+#include "golthreadpool.h"
+#include "goltrace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+
+static const char* s_placementNames[GOLThreadPool::PlacementCount] = { "none", "compact", "spread" };
+
+static GOLThreadPool* s_instance = nullptr;
+static std::mutex s_instanceMutex;
+
+
+// polls for up to POOL_SPIN_NS, with a pause instruction between the polls
+// so the core is not kept busy; false if it has to block after all
+template<typename Done>
+static inline bool spin(Done done)
+{
+    const int64_t end = GOLProfiler::now() + POOL_SPIN_NS;
+    
+    while (!done())
+    {
+        for (int i = 0; i < 32; ++i)
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            _mm_pause();
+#else
+            std::this_thread::yield();
+#endif
+        }
+        
+        if (GOLProfiler::now() >= end) { return false; }
+    }
+    
+    return true;
+}
+
+
+static inline uint64_t pack(uint32_t begin, uint32_t end) { return (uint64_t)begin << 32 | end; }
+
+
+#ifdef __linux__
+
+// "0-3,8-11" as in /sys/devices/system/node/node*/cpulist
+static std::vector<int> parseCpuList(const char* list)
+{
+    std::vector<int> cpus;
+    
+    while (*list)
+    {
+        char* end;
+        int first = (int)std::strtol(list, &end, 10), last = first;
+        if (end == list) { break; }
+        
+        if (*end == '-')
+            last = (int)std::strtol(end + 1, &end, 10);
+        
+        for (int cpu = first; cpu <= last; ++cpu)
+            cpus.push_back(cpu);
+        
+        list = (*end == ',') ? end + 1 : end;
+        if (*list == '\n') { break; }
+    }
+    
+    return cpus;
+}
+
+// the CPUs this process may run on, by NUMA node
+static std::vector<std::vector<int>> nodeCpus()
+{
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+    
+    std::vector<std::vector<int>> nodes;
+    
+    for (int node = 0; ; ++node)
+    {
+        char path[64];
+        std::snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        
+        FILE* file = std::fopen(path, "r");
+        if (!file) { break; }
+        
+        char list[4096] = "";
+        if (!std::fgets(list, sizeof(list), file))
+            list[0] = 0;
+        std::fclose(file);
+        
+        std::vector<int> cpus;
+        for (int cpu : parseCpuList(list))
+        {
+            if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))
+                cpus.push_back(cpu);
+        }
+        
+        if (!cpus.empty())
+            nodes.push_back(cpus);
+    }
+    
+    // no NUMA information, a single node
+    if (nodes.empty())
+    {
+        nodes.resize(1);
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (CPU_ISSET(cpu, &allowed))
+                nodes[0].push_back(cpu);
+        }
+    }
+    
+    return nodes;
+}
+
+#endif
+
+
+GOLThreadPool::GOLThreadPool(int threads, Placement placement)
+ : m_placement(placement)
+ , m_task(nullptr)
+{
+    if (threads <= 0)
+        threads = std::max(1, (int)std::thread::hardware_concurrency());
+    
+    m_slices = new Slice[threads];
+    for (int i = 0; i < threads; ++i)
+        m_slices[i].range.store(0);
+    
+    m_generation.store(0);
+    m_busy.store(0);
+    m_stop.store(false);
+    
+    // the thread calling run() is participant 0
+    for (int i = 1; i < threads; ++i)
+        m_threads.emplace_back(&GOLThreadPool::worker, this, i);
+    
+    if (m_placement != Unpinned)
+        pin();
+}
+
+GOLThreadPool::~GOLThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_stop.store(true);
+        m_generation.fetch_add(1);
+    }
+    
+    m_start.notify_all();
+    
+    for (std::thread& thread : m_threads)
+        thread.join();
+    
+    delete[] m_slices;
+}
+
+
+GOLThreadPool& GOLThreadPool::instance()
+{
+    std::lock_guard<std::mutex> guard(s_instanceMutex);
+    
+    if (!s_instance)
+    {
+        const char* threads = std::getenv("GOL_THREADS");
+        const char* placement = std::getenv("GOL_PLACEMENT");
+        
+        Placement p = Unpinned;
+        
+        for (int i = 0; placement && i < PlacementCount; ++i)
+        {
+            if (strcasecmp(placement, s_placementNames[i]) == 0)
+                p = (Placement)i;
+        }
+        
+        s_instance = new GOLThreadPool(threads ? std::atoi(threads) : 0, p);
+    }
+    
+    return *s_instance;
+}
+
+void GOLThreadPool::configure(int threads, Placement placement)
+{
+    std::lock_guard<std::mutex> guard(s_instanceMutex);
+    
+    delete s_instance;
+    s_instance = new GOLThreadPool(threads, placement);
+}
+
+const char* GOLThreadPool::placementName(Placement placement)
+{
+    return (placement >= 0 && placement < PlacementCount) ? s_placementNames[placement] : "";
+}
+
+
+void GOLThreadPool::run(int count, const std::function<void(int)>& task)
+{
+    const int threads = threadCount();
+    
+    if (threads == 1 || count <= 1)
+    {
+        for (int i = 0; i < count; ++i)
+            task(i);
+        
+        return;
+    }
+    
+    std::lock_guard<std::mutex> guard(m_runMutex);
+    
+    for (int i = 0; i < threads; ++i)
+    {
+        uint32_t begin = (uint32_t)((int64_t)count * i / threads);
+        uint32_t end = (uint32_t)((int64_t)count * (i + 1) / threads);
+        m_slices[i].range.store(pack(begin, end), std::memory_order_relaxed);
+    }
+    
+    m_task = &task;
+    m_busy.store(threads - 1, std::memory_order_relaxed);
+    
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_generation.fetch_add(1, std::memory_order_release);
+    }
+    
+    m_start.notify_all();
+    
+    work(0);
+    
+    if (!spin([this] { return m_busy.load(std::memory_order_acquire) == 0; }))
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this] { return m_busy.load(std::memory_order_acquire) == 0; });
+    }
+    
+    m_task = nullptr;
+}
+
+
+// worker i goes to the i-th CPU of the nodes in order, Spread first takes
+// an equal share of the threads from every node
+void GOLThreadPool::pin()
+{
+#ifdef __linux__
+    std::vector<std::vector<int>> nodes = nodeCpus();
+    std::vector<int> cpus;
+    
+    if (m_placement == Spread)
+    {
+        const int threads = threadCount();
+        
+        for (size_t n = 0; n < nodes.size(); ++n)
+        {
+            size_t share = threads / nodes.size() + (n < threads % nodes.size());
+            share = std::max((size_t)1, std::min(share, nodes[n].size()));
+            cpus.insert(cpus.end(), nodes[n].begin(), nodes[n].begin() + share);
+        }
+    }
+    else
+    {
+        for (const std::vector<int>& node : nodes)
+            cpus.insert(cpus.end(), node.begin(), node.end());
+    }
+    
+    if (cpus.empty()) { return; }
+    
+    for (size_t i = 0; i < m_threads.size(); ++i)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpus[(i + 1) % cpus.size()], &set);
+        
+        pthread_setaffinity_np(m_threads[i].native_handle(), sizeof(set), &set);
+    }
+#endif
+}
+
+
+void GOLThreadPool::worker(int index)
+{
+    uint64_t seen = 0;
+    
+    GOLTrace::setThreadName("worker " + std::to_string(index));
+    
+    while (true)
+    {
+        // a generation is usually due again shortly, so poll a while first
+        if (!spin([&] { return m_generation.load(std::memory_order_acquire) != seen; }))
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_start.wait(lock, [&] { return m_generation.load(std::memory_order_acquire) != seen; });
+        }
+        
+        seen = m_generation.load(std::memory_order_acquire);
+        
+        if (m_stop.load()) { return; }
+        
+        work(index);
+        
+        if (m_busy.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            m_done.notify_one();
+        }
+    }
+}
+
+void GOLThreadPool::work(int index)
+{
+    int task;
+    
+    do
+    {
+        while (pop(index, task))
+            (*m_task)(task);
+    }
+    while (steal(index));
+}
+
+bool GOLThreadPool::pop(int index, int& task)
+{
+    std::atomic<uint64_t>& range = m_slices[index].range;
+    uint64_t r = range.load(std::memory_order_acquire);
+    
+    while (true)
+    {
+        uint32_t begin = (uint32_t)(r >> 32), end = (uint32_t)r;
+        if (begin >= end) { return false; }
+        
+        if (range.compare_exchange_weak(r, pack(begin + 1, end), std::memory_order_acq_rel))
+        {
+            task = (int)begin;
+            return true;
+        }
+    }
+}
+
+// moves the back half of the first non-empty slice of another participant
+// into the own, empty one
+bool GOLThreadPool::steal(int index)
+{
+    const int threads = threadCount();
+    
+    for (int i = 1; i < threads; ++i)
+    {
+        std::atomic<uint64_t>& range = m_slices[(index + i) % threads].range;
+        uint64_t r = range.load(std::memory_order_acquire);
+        
+        while (true)
+        {
+            uint32_t begin = (uint32_t)(r >> 32), end = (uint32_t)r;
+            if (begin >= end) { break; }
+            
+            uint32_t mid = begin + (end - begin) / 2;
+            
+            if (range.compare_exchange_weak(r, pack(begin, mid), std::memory_order_acq_rel))
+            {
+                m_slices[index].range.store(pack(mid, end), std::memory_order_release);
+                return true;
+            }
+        }
+    }
+    
+    return false;
+}
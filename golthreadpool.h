@@ -0,0 +1,101 @@
+#ifndef GOLTHREADPOOL_H
+#define GOLTHREADPOOL_H
+
+
+#define POOL_SPIN_NS  50000  // an idle worker polls this long before it blocks
+
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+// Persistent worker threads for the engines' per-generation loops, so a step
+// does not fork and join threads. run() hands every participant (the workers
+// and the calling thread) an even slice of the tasks; whoever runs out steals
+// the back half of another slice, so a few expensive tiles in one corner of
+// the board spread over all cores.
+//
+// A slice is a single atomic word (begin << 32 | end): the owner takes tasks
+// from the front and thieves cut off the back, both with one compare-exchange.
+//
+// Slices are handed out in the same order every time, so participant i gets
+// about the same band of a board from run to run. Memory first touched in such
+// a run (see GOLGrid) ends up on the NUMA node of the worker that steps it,
+// and pinning the workers keeps it there. The calling thread is participant 0
+// and is never pinned.
+
+class GOLThreadPool
+{
+public:
+    
+    enum Placement
+    {
+        Unpinned,
+        Compact, // fill one NUMA node after the other
+        Spread,  // as many threads on every node
+        PlacementCount
+    };
+    
+    
+    explicit GOLThreadPool(int threads = 0, Placement placement = Unpinned); // 0: one per core
+    ~GOLThreadPool();
+    
+    // the pool of the engines, GOL_THREADS and GOL_PLACEMENT (none, compact
+    // or spread) set it up on first use
+    static GOLThreadPool& instance();
+    // replaces it, no engine may be stepping meanwhile
+    static void configure(int threads, Placement placement);
+    
+    static const char* placementName(Placement placement);
+    
+    
+    inline int threadCount() const { return (int)m_threads.size() + 1; }
+    inline Placement placement() const { return m_placement; }
+    
+    // calls task(i) for every i in [0, count) and returns when all are done,
+    // concurrent calls take turns, a task must not call it again
+    void run(int count, const std::function<void(int)>& task);
+    
+    
+private:
+    
+    // one per cache line
+    struct Slice
+    {
+        std::atomic<uint64_t> range;
+        char padding[64 - sizeof(std::atomic<uint64_t>)];
+    };
+    
+    
+    // Methods:
+    
+    void pin();
+    void worker(int index);
+    void work(int index);
+    bool pop(int index, int& task);
+    bool steal(int index);
+    
+    
+    // Attributes:
+    
+    std::vector<std::thread> m_threads;
+    Placement m_placement;
+    Slice* m_slices;
+    
+    const std::function<void(int)>* m_task;
+    
+    std::atomic<uint64_t> m_generation;
+    std::atomic_int m_busy;
+    std::atomic_bool m_stop;
+    
+    std::mutex m_mutex, m_runMutex;
+    std::condition_variable m_start, m_done;
+    
+};
+
+#endif // GOLTHREADPOOL_H
@@ -0,0 +1,50 @@
+#include "golticketmutex.h"
+#include "goltrace.h"
+
+
+GOLTicketMutex::GOLTicketMutex()
+ : m_profiler(nullptr)
+{
+    m_next.store(0);
+    m_serving.store(0);
+}
+
+
+void GOLTicketMutex::lock()
+{
+    unsigned ticket = m_next.fetch_add(1, std::memory_order_relaxed);
+    
+    if (m_serving.load(std::memory_order_acquire) == ticket)
+    {
+        if (m_profiler)
+            m_profiler->record(GOLProfiler::LockWait, 0);
+        
+        return;
+    }
+    
+    const int64_t start = m_profiler && m_profiler->enabled() ? GOLProfiler::now() : 0;
+    GOLTraceScope scope("lock wait");
+    
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_turn.wait(lock, [&] { return m_serving.load(std::memory_order_acquire) == ticket; });
+    
+    if (m_profiler)
+        m_profiler->record(GOLProfiler::LockWait, GOLProfiler::now() - start);
+}
+
+void GOLTicketMutex::unlock()
+{
+    bool waiting;
+    
+    // a thread about to wait holds m_mutex after taking its ticket, so it is
+    // either counted here or sees its turn before waiting
+    {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        
+        unsigned serving = m_serving.fetch_add(1, std::memory_order_release) + 1;
+        waiting = m_next.load(std::memory_order_relaxed) != serving;
+    }
+    
+    if (waiting)
+        m_turn.notify_all();
+}
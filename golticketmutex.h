@@ -0,0 +1,47 @@
+#ifndef GOLTICKETMUTEX_H
+#define GOLTICKETMUTEX_H
+
+
+#include "golprofiler.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+
+// Mutex that is handed over in the order it was asked for. An uncapped
+// simulation relocks right after unlocking, a plain std::mutex would let it
+// win over a waiting GUI thread again and again.
+
+class GOLTicketMutex
+{
+public:
+    
+    GOLTicketMutex();
+    
+    GOLTicketMutex(const GOLTicketMutex&) = delete;
+    GOLTicketMutex& operator=(const GOLTicketMutex&) = delete;
+    
+    
+    void lock();
+    void unlock();
+    
+    // whether another thread is queued for it, only meaningful to the owner
+    inline bool contended() const { return m_next.load(std::memory_order_relaxed) - m_serving.load(std::memory_order_relaxed) > 1; }
+    
+    // every lock() records how long it waited, set before the mutex is shared
+    inline void setProfiler(GOLProfiler* profiler) { m_profiler = profiler; }
+    
+    
+private:
+    
+    GOLProfiler* m_profiler;
+    
+    std::atomic_uint m_next, m_serving;
+    
+    std::mutex m_mutex;
+    std::condition_variable m_turn;
+    
+};
+
+#endif // GOLTICKETMUTEX_H
@@ -0,0 +1,136 @@
+#include "goltrace.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+
+struct TraceEvent
+{
+    std::atomic<const char*> name;
+    std::atomic<int64_t> begin, end, arg, y;
+};
+
+struct TraceBuffer
+{
+    int id;
+    std::string name;
+    
+    TraceEvent events[TRACE_EVENTS];
+    std::atomic<uint64_t> count;
+};
+
+
+std::atomic<bool> GOLTrace::s_active(false);
+std::atomic<int64_t> GOLTrace::s_start(0);
+
+// kept after their threads end, the events stay part of the trace
+static std::vector<TraceBuffer*> s_buffers;
+static std::mutex s_buffersMutex;
+
+static thread_local TraceBuffer* t_buffer = nullptr;
+static thread_local std::string t_name;
+
+
+void GOLTrace::start()
+{
+    s_start.store(GOLProfiler::now());
+    s_active.store(true);
+}
+
+void GOLTrace::stop()
+{
+    s_active.store(false);
+}
+
+
+void GOLTrace::setThreadName(const std::string& name)
+{
+    t_name = name;
+    
+    if (t_buffer)
+    {
+        std::lock_guard<std::mutex> guard(s_buffersMutex);
+        t_buffer->name = name;
+    }
+}
+
+
+void GOLTrace::record(const char* name, int64_t begin, int64_t end, int64_t arg, int64_t y)
+{
+    if (!t_buffer)
+    {
+        std::lock_guard<std::mutex> guard(s_buffersMutex);
+        
+        t_buffer = new TraceBuffer();
+        t_buffer->id = (int)s_buffers.size() + 1;
+        t_buffer->name = t_name.empty() ? "thread " + std::to_string(t_buffer->id) : t_name;
+        t_buffer->count.store(0);
+        
+        s_buffers.push_back(t_buffer);
+    }
+    
+    // only this thread writes the ring
+    uint64_t i = t_buffer->count.load(std::memory_order_relaxed);
+    TraceEvent& e = t_buffer->events[i % TRACE_EVENTS];
+    
+    e.name.store(name, std::memory_order_relaxed);
+    e.begin.store(begin, std::memory_order_relaxed);
+    e.end.store(end, std::memory_order_relaxed);
+    e.arg.store(arg, std::memory_order_relaxed);
+    e.y.store(y, std::memory_order_relaxed);
+    
+    t_buffer->count.store(i + 1, std::memory_order_release);
+}
+
+
+bool GOLTrace::save(const std::string& path)
+{
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) { return false; }
+    
+    const int64_t start = s_start.load();
+    bool first = true;
+    
+    std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    
+    std::lock_guard<std::mutex> guard(s_buffersMutex);
+    
+    for (TraceBuffer* b : s_buffers)
+    {
+        std::fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                     first ? "" : ",", b->id, b->name.c_str());
+        first = false;
+        
+        const uint64_t count = b->count.load(std::memory_order_acquire);
+        
+        for (uint64_t i = count - std::min<uint64_t>(count, TRACE_EVENTS); i < count; ++i)
+        {
+            const TraceEvent& e = b->events[i % TRACE_EVENTS];
+            const int64_t begin = e.begin.load(std::memory_order_relaxed);
+            
+            if (begin < start) { continue; }
+            
+            // complete events, microseconds since start()
+            std::fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+                         e.name.load(std::memory_order_relaxed), b->id, (begin - start) / 1e3,
+                         (e.end.load(std::memory_order_relaxed) - begin) / 1e3);
+            
+            const int64_t arg = e.arg.load(std::memory_order_relaxed);
+            const int64_t y = e.y.load(std::memory_order_relaxed);
+            if (y != TRACE_NO_ARG)
+                std::fprintf(file, ",\"args\":{\"x\":%" PRId64 ",\"y\":%" PRId64 "}", arg, y);
+            else if (arg >= 0)
+                std::fprintf(file, ",\"args\":{\"index\":%" PRId64 "}", arg);
+            
+            std::fprintf(file, "}");
+        }
+    }
+    
+    std::fprintf(file, "\n]}\n");
+    
+    bool success = !std::ferror(file);
+    return std::fclose(file) == 0 && success;
+}
@@ -0,0 +1,90 @@
+#ifndef GOLTRACE_H
+#define GOLTRACE_H
+
+
+#define TRACE_EVENTS  65536      // per thread, a trace keeps the latest ones
+#define TRACE_NO_ARG  INT64_MIN  // an event without a y coordinate
+
+
+#include "golprofiler.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+
+// Timeline of what every thread did, saved as Chrome trace JSON for
+// chrome://tracing or ui.perfetto.dev. Every thread writes its events into a
+// ring of its own without a lock, allocated the first time it records one.
+// While no trace runs a GOLTraceScope costs a single atomic load.
+//
+// The times are those of GOLProfiler::now(), so both line up.
+
+class GOLTrace
+{
+public:
+    
+    static void start();
+    static void stop();
+    static inline bool active() { return s_active.load(std::memory_order_relaxed); }
+    
+    // the events since start(), best after stop(), an event recorded meanwhile
+    // may overwrite the one being written out
+    static bool save(const std::string& path);
+    
+    // the name of the calling thread in the trace
+    static void setThreadName(const std::string& name);
+    
+    // name has to live as long as the trace, a literal; an event carries an
+    // index if arg >= 0 or, with a y, the coordinates arg, y
+    static void record(const char* name, int64_t begin, int64_t end, int64_t arg = -1, int64_t y = TRACE_NO_ARG);
+    
+    
+private:
+    
+    static std::atomic<bool> s_active;
+    static std::atomic<int64_t> s_start;
+    
+};
+
+
+// records the time from construction to destruction if a trace is running
+class GOLTraceScope
+{
+public:
+    
+    inline explicit GOLTraceScope(const char* name, int64_t arg = -1)
+      : m_name(GOLTrace::active() ? name : nullptr)
+      , m_arg(arg)
+      , m_y(TRACE_NO_ARG)
+      , m_begin(m_name ? GOLProfiler::now() : 0)
+    {
+    }
+    
+    // an event at the coordinates x, y, a chunk of an unbounded universe
+    inline GOLTraceScope(const char* name, int64_t x, int64_t y)
+      : m_name(GOLTrace::active() ? name : nullptr)
+      , m_arg(x)
+      , m_y(y)
+      , m_begin(m_name ? GOLProfiler::now() : 0)
+    {
+    }
+    
+    inline ~GOLTraceScope()
+    {
+        if (m_name)
+            GOLTrace::record(m_name, m_begin, GOLProfiler::now(), m_arg, m_y);
+    }
+    
+    GOLTraceScope(const GOLTraceScope&) = delete;
+    GOLTraceScope& operator=(const GOLTraceScope&) = delete;
+    
+    
+private:
+    
+    const char* m_name;
+    int64_t m_arg, m_y, m_begin;
+    
+};
+
+#endif // GOLTRACE_H
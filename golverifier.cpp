@@ -0,0 +1,882 @@
+#include "golverifier.h"
+#include "golfile.h"
+#include "golrunner.h"
+#include "golthreadpool.h"
+
+#include <QCommandLineParser>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+
+static const std::vector<GOLVerifier::Pattern> s_corpus =
+{
+    // spaceships into the corner, across the seam of odd sized tori
+    { "glider", "x = 3, y = 3\nbob$2bo$3o!", "B3/S23", 64, 64, 10, 10, 240, false },
+    { "glider-wrap", "x = 3, y = 3\nbob$2bo$3o!", "B3/S23", 50, 40, 44, 34, 400, true },
+    { "lwss", "x = 5, y = 4\nbo2bo$o4b$o3bo$4o!", "B3/S23", 100, 30, 4, 12, 200, false },
+    { "lwss-wrap", "x = 5, y = 4\nbo2bo$o4b$o3bo$4o!", "B3/S23", 67, 20, 4, 8, 300, true },
+    
+    // its gliders pile up at the edges
+    { "gosper-gun", "x = 36, y = 9\n24bo$22bobo$12b2o6b2o12b2o$11bo3bo4b2o12b2o$2o8bo5bo3b2o$"
+                    "2o8bo3bob2o4bobo$10bo5bo7bo$11bo3bo$12b2o!", "B3/S23", 80, 60, 2, 2, 400, false },
+    
+    // methuselahs, the second one on the corners of four grid engine tiles
+    { "r-pentomino", "x = 3, y = 3\nb2o$2o$bo!", "B3/S23", 260, 260, 128, 128, 600, false },
+    { "tile-seams", "x = 3, y = 3\nb2o$2o$bo!", "B3/S23", 512, 192, 254, 62, 300, false },
+    { "acorn", "x = 7, y = 3\nbo$3bo$2o2b3o!", "B3/S23", 400, 300, 196, 148, 600, false },
+    { "diehard", "x = 8, y = 3\n6bob$2o6b$bo3b3o!", "B3/S23", 64, 64, 28, 30, 140, false },
+    
+    { "pulsar", "x = 13, y = 13\n2b3o3b3o2b2$o4bobo4bo$o4bobo4bo$o4bobo4bo$2b3o3b3o2b2$"
+                "2b3o3b3o2b$o4bobo4bo$o4bobo4bo$o4bobo4bo2$2b3o3b3o!", "B3/S23", 31, 31, 9, 9, 30, false },
+    
+    // half of the blinker beyond the last row and column, a line along the
+    // edge whose ends die off, the same as a ring around the torus
+    { "corner-blinker", "x = 3, y = 1\n3o!", "B3/S23", 70, 33, 67, 32, 10, false },
+    { "corner-blinker-wrap", "x = 3, y = 1\n3o!", "B3/S23", 70, 33, 67, 32, 10, true },
+    { "edge-line", "x = 67, y = 1\n67o!", "B3/S23", 100, 50, 0, 0, 100, false },
+    { "edge-line-wrap", "x = 67, y = 1\n67o!", "B3/S23", 67, 50, 0, 0, 100, true },
+    
+    { "replicator", "x = 5, y = 5\n2b3o$bo2bo$o3bo$o2bo$3o!", "B36/S23", 128, 128, 62, 62, 200, false },
+    
+    // a soup of every rule family, the last two only for the multi-state engine
+    { "soup", NULL, "B3/S23", 200, 150, 0, 0, 300, false },
+    { "soup-wrap", NULL, "B3/S23", 200, 150, 0, 0, 300, true },
+    { "day-night", NULL, "B3678/S34678", 130, 100, 0, 0, 200, false },
+    { "brians-brain", NULL, "B2/S/C3", 96, 96, 0, 0, 100, false },
+    { "bosco", NULL, "R5,C0,M1,S34..58,B34..45,NM", 96, 96, 0, 0, 100, false },
+};
+
+// the leaps of the engines that take them, compared besides single generations
+static const int s_leapExponents[] = { 1, 3, 6 };
+
+static const std::vector<GOLVerifier::Settling> s_settling =
+{
+    // single generations, then leaps the period divides and one it does not
+    { { "block", "x = 2, y = 2\n2o$2o!", "B3/S23", 32, 32, 15, 15, 100, false },
+      0, GOLPeriodDetector::StillLife, 1 },
+    { { "blinker", "x = 3, y = 1\n3o!", "B3/S23", 32, 32, 14, 15, 100, false },
+      0, GOLPeriodDetector::Oscillating, 2 },
+    { { "block-leap8", "x = 2, y = 2\n2o$2o!", "B3/S23", 32, 32, 15, 15, 1000, false },
+      3, GOLPeriodDetector::StillLife, 1 },
+    { { "blinker-leap2", "x = 3, y = 1\n3o!", "B3/S23", 32, 32, 14, 15, 1000, false },
+      1, GOLPeriodDetector::Oscillating, 2 },
+    { { "blinker-leap16", "x = 3, y = 1\n3o!", "B3/S23", 32, 32, 14, 15, 1000, false },
+      4, GOLPeriodDetector::Oscillating, 2 },
+    { { "pulsar-leap4", "x = 13, y = 13\n2b3o3b3o2b2$o4bobo4bo$o4bobo4bo$o4bobo4bo$2b3o3b3o2b2$"
+                        "2b3o3b3o2b$o4bobo4bo$o4bobo4bo$o4bobo4bo2$2b3o3b3o!", "B3/S23", 31, 31, 9, 9, 1000, false },
+      2, GOLPeriodDetector::Oscillating, 3 },
+    { { "diehard-leap8", "x = 8, y = 3\n6bob$2o6b$bo3b3o!", "B3/S23", 64, 64, 28, 30, 1000, false },
+      3, GOLPeriodDetector::Extinct, 1 },
+};
+
+
+// the same random board whatever order the cells are set in
+static inline uint64_t mix(uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    
+    return x ^ (x >> 31);
+}
+
+static inline bool sameBounds(const GOLBounds& a, const GOLBounds& b)
+{
+    if (a.empty() || b.empty()) { return a.empty() == b.empty(); }
+    
+    return a.x0 == b.x0 && a.y0 == b.y0 && a.x1 == b.x1 && a.y1 == b.y1;
+}
+
+static std::string boundsString(const GOLBounds& b)
+{
+    if (b.empty()) { return "empty"; }
+    
+    return std::to_string(b.width()) + "x" + std::to_string(b.height()) + " at " +
+           std::to_string(b.x0) + ", " + std::to_string(b.y0);
+}
+
+static std::string settledString(GOLPeriodDetector::State state, uint64_t period)
+{
+    return std::string(GOLPeriodDetector::stateName(state)) + ", period " + std::to_string(period);
+}
+
+
+GOLVerifier::GOLVerifier()
+ : m_generations(VERIFY_GENERATIONS)
+ , m_list(false)
+ , m_matched(0)
+ , m_diverged(0)
+ , m_skipped(0)
+{
+}
+
+
+const std::vector<GOLVerifier::Pattern>& GOLVerifier::corpus()
+{
+    return s_corpus;
+}
+
+const std::vector<GOLVerifier::Settling>& GOLVerifier::settlingCorpus()
+{
+    return s_settling;
+}
+
+GOLVerifier::Case GOLVerifier::soup(const std::string& name, const GOLRule& rule, int cols, int rows,
+                                    int generations, bool wrap)
+{
+    Case c = { name, rule, cols, rows, generations, wrap, std::vector<uint8_t>((size_t)cols * rows) };
+    
+    for (size_t i = 0; i < c.states.size(); ++i)
+        c.states[i] = mix(VERIFY_SEED + i) % 100 < VERIFY_SOUP_DENSITY;
+    
+    return c;
+}
+
+
+const char* GOLVerifier::sideName(int side)
+{
+    return side == Reference ? "Reference" : GOLEngine::typeName((GOLEngine::Type)side);
+}
+
+int GOLVerifier::maxStepExponent(int side)
+{
+    if (side == Reference) { return 0; }
+    
+    GOLEngine* engine = GOLEngine::create((GOLEngine::Type)side, 1, 1);
+    const int exponent = engine->maxStepExponent();
+    delete engine;
+    
+    return exponent;
+}
+
+// FNV-1a
+uint64_t GOLVerifier::checksum(const std::vector<uint8_t>& states)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    
+    for (uint8_t state : states)
+        hash = (hash ^ state) * 0x100000001b3ULL;
+    
+    return hash;
+}
+
+
+int GOLVerifier::run(const QStringList& arguments)
+{
+    if (!parse(arguments)) { return 2; }
+    
+    if (m_list)
+    {
+        QTextStream out(stdout);
+        
+        for (const Pattern& p : s_corpus)
+            out << QString("%1 %2 %3x%4%5, %6 generations\n").arg(QString(p.name), -20).arg(QString(p.rule), -28)
+                   .arg(p.cols).arg(p.rows).arg(p.wrap ? " wrapped" : "").arg(p.generations);
+        
+        for (const Settling& s : s_settling)
+            out << QString("%1 %2 %3x%4, leaps of 2^%5, %6\n").arg(QString(s.pattern.name), -20)
+                   .arg(QString(s.pattern.rule), -28).arg(s.pattern.cols).arg(s.pattern.rows).arg(s.exponent)
+                   .arg(QString::fromStdString(settledString(s.state, s.period)));
+        
+        return 0;
+    }
+    
+    std::vector<Case> cases;
+    
+    for (const Pattern& p : s_corpus)
+    {
+        if (!m_patterns.isEmpty() && !m_patterns.contains(p.name)) { continue; }
+        
+        Case c;
+        if (!decode(p, c)) { return 2; }
+        
+        cases.push_back(c);
+    }
+    
+    for (const QString& path : m_files)
+    {
+        Case c;
+        if (!load(path, c)) { return 2; }
+        
+        cases.push_back(c);
+    }
+    
+    for (const Case& c : cases)
+    {
+        for (const std::pair<int, int>& pair : m_pairs)
+        {
+            report(c, pair.first, pair.second, 0, verify(c, pair.first, pair.second));
+            
+            const int leap = std::max(maxStepExponent(pair.first), maxStepExponent(pair.second));
+            
+            for (int exponent : s_leapExponents)
+            {
+                if (exponent <= leap && (1 << exponent) <= c.generations)
+                    report(c, pair.first, pair.second, exponent, verify(c, pair.first, pair.second, exponent));
+            }
+        }
+    }
+    
+    // the detector with every engine that is compared
+    std::vector<int> types;
+    for (const std::pair<int, int>& pair : m_pairs)
+    {
+        for (int side : { pair.first, pair.second })
+        {
+            if (side != Reference && std::find(types.begin(), types.end(), side) == types.end())
+                types.push_back(side);
+        }
+    }
+    
+    for (const Settling& s : s_settling)
+    {
+        if (!m_patterns.isEmpty() && !m_patterns.contains(s.pattern.name)) { continue; }
+        
+        for (int type : types)
+        {
+            reportSettling(s, type, false, settle(s, type, false));
+            reportSettling(s, type, true, settle(s, type, true));
+        }
+    }
+    
+    QTextStream(stdout) << QString("\n%1 matched, %2 diverged, %3 skipped\n")
+                           .arg(m_matched).arg(m_diverged).arg(m_skipped);
+    
+    return m_diverged > 0 ? 1 : 0;
+}
+
+
+bool GOLVerifier::parse(const QStringList& arguments)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Runs two engines in lockstep and compares them every generation.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("files", "Further .gol or .rle patterns to verify.", "[files...]");
+    
+    QCommandLineOption engines("engines", "One engine to compare with the reference or two to compare "
+                               "with each other: reference, grid, hashlife, infinite, multi-state. "
+                               "Every engine with the reference by default.", "list");
+    QCommandLineOption patterns("patterns", "Only these patterns of the corpus, comma separated.", "list");
+    QCommandLineOption list("list", "Lists the corpus.");
+    QCommandLineOption generations(QStringList() << "n" << "generations", "Generations of the files.",
+                                   "count", QString::number(VERIFY_GENERATIONS));
+    QCommandLineOption threads("threads", "Worker threads, 0 for one per core.", "count");
+    
+    parser.addOptions(QList<QCommandLineOption>() << engines << patterns << list << generations << threads);
+    
+    parser.process(arguments);
+    
+    m_list = parser.isSet(list);
+    m_files = parser.positionalArguments();
+    
+    bool ok;
+    m_generations = parser.value(generations).toInt(&ok);
+    if (!ok || m_generations < 0)
+    {
+        QTextStream(stderr) << "Invalid generations " << parser.value(generations) << "\n";
+        return false;
+    }
+    
+    if (parser.isSet(patterns))
+    {
+        m_patterns = parser.value(patterns).toLower().split(',');
+        
+        for (const QString& name : m_patterns)
+        {
+            if (std::none_of(s_corpus.begin(), s_corpus.end(), [&](const Pattern& p) { return name == p.name; }) &&
+                std::none_of(s_settling.begin(), s_settling.end(), [&](const Settling& s) { return name == s.pattern.name; }))
+            {
+                QTextStream(stderr) << "Unknown pattern " << name << ", see --list\n";
+                return false;
+            }
+        }
+    }
+    
+    if (parser.isSet(engines))
+    {
+        std::vector<int> sides;
+        
+        for (const QString& name : parser.value(engines).toLower().remove('-').split(','))
+        {
+            int side = 0;
+            while (side <= Reference && name != QString(sideName(side)).toLower().remove('-'))
+                ++side;
+            
+            if (side > Reference)
+            {
+                QTextStream(stderr) << "Unknown engine " << name << "\n";
+                return false;
+            }
+            
+            sides.push_back(side);
+        }
+        
+        if (sides.size() == 1)
+            sides.push_back(Reference);
+        
+        if (sides.size() != 2 || sides[0] == sides[1])
+        {
+            QTextStream(stderr) << "Expected one or two different engines\n";
+            return false;
+        }
+        
+        m_pairs.push_back(std::make_pair(sides[0], sides[1]));
+    }
+    else
+    {
+        for (int type = 0; type < GOLEngine::TypeCount; ++type)
+            m_pairs.push_back(std::make_pair(type, (int)Reference));
+    }
+    
+    if (parser.isSet(threads))
+        GOLThreadPool::configure(std::max(0, parser.value(threads).toInt()), GOLThreadPool::Unpinned);
+    
+    return true;
+}
+
+bool GOLVerifier::decode(const Pattern& pattern, Case& c)
+{
+    GOLRule rule;
+    GOLRule::parse(pattern.rule, rule);
+    
+    if (!pattern.rle)
+    {
+        c = soup(pattern.name, rule, pattern.cols, pattern.rows, pattern.generations, pattern.wrap);
+        return true;
+    }
+    
+    int cols = 0, rows = 0;
+    bool* cells = GOLFile::fromRle(QByteArray(pattern.rle), cols, rows);
+    
+    if (!cells)
+    {
+        QTextStream(stderr) << "Invalid pattern " << pattern.name << "\n";
+        return false;
+    }
+    
+    c = { pattern.name, rule, pattern.cols, pattern.rows, pattern.generations, pattern.wrap,
+          std::vector<uint8_t>((size_t)pattern.cols * pattern.rows) };
+    
+    for (int y = 0; y < rows; ++y)
+    {
+        for (int x = 0; x < cols; ++x)
+            c.states[(size_t)(pattern.y + y) * c.cols + pattern.x + x] = cells[y * cols + x];
+    }
+    
+    delete[] cells;
+    
+    return true;
+}
+
+bool GOLVerifier::load(const QString& path, Case& c)
+{
+    int cols = 0, rows = 0;
+    QString ruleStr;
+    bool* cells = GOLFile::load(path, cols, rows, &ruleStr);
+    
+    GOLRule rule;
+    
+    if (!cells || (!ruleStr.isEmpty() && !GOLRule::parse(ruleStr.toStdString(), rule)))
+    {
+        QTextStream(stderr) << "Could not read " << path << "\n";
+        delete[] cells;
+        return false;
+    }
+    
+    c = { QFileInfo(path).fileName().toStdString(), rule, cols + 2 * VERIFY_FILE_MARGIN,
+          rows + 2 * VERIFY_FILE_MARGIN, m_generations, false, std::vector<uint8_t>() };
+    c.states.resize((size_t)c.cols * c.rows);
+    
+    for (int y = 0; y < rows; ++y)
+    {
+        for (int x = 0; x < cols; ++x)
+            c.states[(size_t)(y + VERIFY_FILE_MARGIN) * c.cols + x + VERIFY_FILE_MARGIN] = cells[y * cols + x];
+    }
+    
+    delete[] cells;
+    
+    return true;
+}
+
+
+GOLVerifier::Result GOLVerifier::verify(const Case& c, int a, int b, int exponent)
+{
+    Result result = { Result::Skipped, 0, { 0, 0 }, 0, GOLBounds(), std::string() };
+    
+    const int sides[2] = { a, b };
+    GOLEngine* engines[2] = { nullptr, nullptr };
+    
+    for (int i = 0; i < 2 && result.message.empty(); ++i)
+    {
+        if (sides[i] != Reference)
+            engines[i] = createEngine(sides[i], c, result.message);
+    }
+    
+    if (result.message.empty())
+    {
+        if (a == b)
+            result.message = "the same side twice";
+        else if (engines[0] && engines[1] && engines[0]->canWrap() != engines[1]->canWrap())
+            result.message = "the engines treat the edges differently";
+    }
+    
+    if (!result.message.empty())
+    {
+        delete engines[0];
+        delete engines[1];
+        return result;
+    }
+    
+    if (!engines[0] || !engines[1])
+        createBoard(c, !(engines[0] ? engines[0] : engines[1])->canWrap());
+    
+    // single generations for the sides that cannot leap that far
+    const int leap = 1 << exponent;
+    int steps[2];
+    
+    for (int i = 0; i < 2; ++i)
+    {
+        steps[i] = leap;
+        
+        if (engines[i] && engines[i]->maxStepExponent() >= exponent)
+        {
+            engines[i]->setStepExponent(exponent);
+            steps[i] = 1;
+        }
+    }
+    
+    std::vector<uint8_t> states[2], previous[2];
+    result.outcome = Result::Match;
+    
+    for (int g = 0; g <= c.generations && result.outcome == Result::Match; g += leap)
+    {
+        result.generation = g;
+        
+        for (int i = 0; i < 2; ++i)
+        {
+            if (g > 0)
+            {
+                previous[i].swap(states[i]);
+                
+                for (int s = 0; s < steps[i]; ++s)
+                {
+                    if (engines[i])
+                        engines[i]->step();
+                    else
+                        stepBoard();
+                }
+            }
+            
+            read(engines[i], states[i]);
+            result.checksums[i] = checksum(states[i]);
+        }
+        
+        if (states[0] != states[1])
+        {
+            result.outcome = Result::Diverged;
+            
+            for (size_t j = 0; j < states[0].size(); ++j)
+            {
+                if (states[0][j] != states[1][j])
+                {
+                    result.region.extend((int)(j % c.cols), (int)(j / c.cols));
+                    ++result.cells;
+                }
+            }
+            
+            break;
+        }
+        
+        // what the engines keep besides the cells, the scene shows it
+        for (int i = 0; i < 2 && result.outcome == Result::Match; ++i)
+        {
+            if (!engines[i]) { continue; }
+            
+            // the unbounded engines count the cells beyond the board as well
+            uint64_t population = std::count(states[i].begin(), states[i].end(), 1);
+            if (!engines[i]->canWrap())
+                population = engines[1 - i] ? engines[1 - i]->population() : m_board.population;
+            
+            // the changed regions are those of the last step, a single generation
+            std::string error = checkStats(engines[i], states[i], population, g > 0);
+            if (error.empty() && g > 0 && leap == 1)
+                error = checkChanges(engines[i], previous[i], states[i]);
+            if (!error.empty())
+            {
+                result.outcome = Result::Diverged;
+                result.message = std::string(sideName(sides[i])) + ": " + error;
+            }
+        }
+    }
+    
+    delete engines[0];
+    delete engines[1];
+    
+    return result;
+}
+
+
+// stepped like GOLScene::tick(), in single generations while the detector
+// asks for them
+GOLVerifier::Result GOLVerifier::settle(const Settling& s, int type, bool runner)
+{
+    Result result = { Result::Skipped, 0, { 0, 0 }, 0, GOLBounds(), std::string() };
+    
+    Case c;
+    if (!decode(s.pattern, c))
+    {
+        result.message = "invalid pattern";
+        return result;
+    }
+    
+    GOLEngine* engine = createEngine(type, c, result.message);
+    if (!engine) { return result; }
+    
+    if (runner)
+    {
+        delete engine;
+        
+        QTemporaryDir dir;
+        const QString pattern = dir.filePath("pattern.rle");
+        const QString statsPath = dir.filePath("stats.json");
+        
+        // multi-state RLE for the rules with dying states
+        bool saved = GOLFile::saveStates(pattern, c.states.data(), c.cols, c.rows, c.rule.states,
+                                         QString::fromStdString(c.rule.toString()));
+        
+        GOLRunner run;
+        
+        if (!saved || run.run(QStringList() << "GameOfLifeVerify" << RUNNER_FLAG << pattern
+                              << "--engine" << QString(sideName(type)).remove('-')
+                              << "--size" << QString("%1x%2").arg(c.cols).arg(c.rows)
+                              << "-n" << QString::number(c.generations)
+                              << "--stop-when-settled" << "--stats" << statsPath) != 0)
+        {
+            result.message = "the runner failed";
+            return result;
+        }
+        
+        QFile file(statsPath);
+        file.open(QFile::ReadOnly);
+        const QJsonObject stats = QJsonDocument::fromJson(file.readAll()).object();
+        const uint64_t period = (uint64_t)stats["period"].toDouble();
+        
+        result.generation = stats["generations"].toInt();
+        result.outcome = (stats["state"].toString() == GOLPeriodDetector::stateName(s.state) && period == s.period)
+                         ? Result::Match : Result::Diverged;
+        result.message = stats["state"].toString().toStdString() + ", period " + std::to_string(period);
+        
+        return result;
+    }
+    
+    if (engine->maxStepExponent() < s.exponent)
+    {
+        result.message = std::string(sideName(type)) + " cannot leap 2^" + std::to_string(s.exponent);
+        delete engine;
+        return result;
+    }
+    
+    GOLPeriodDetector detector;
+    uint64_t generation = 0;
+    
+    while (detector.state() == GOLPeriodDetector::Running && generation < (uint64_t)c.generations)
+    {
+        engine->setStepExponent(detector.resolving() ? 0 : s.exponent);
+        engine->step();
+        
+        generation += engine->stepSize();
+        detector.update(engine->hash(), engine->population(), generation);
+    }
+    
+    delete engine;
+    
+    result.generation = (int)generation;
+    result.outcome = (detector.state() == s.state && detector.period() == s.period) ? Result::Match
+                                                                                    : Result::Diverged;
+    result.message = settledString(detector.state(), detector.period());
+    
+    return result;
+}
+
+
+GOLEngine* GOLVerifier::createEngine(int type, const Case& c, std::string& error) const
+{
+    GOLEngine* engine = GOLEngine::create((GOLEngine::Type)type, c.cols, c.rows);
+    
+    if (!engine->supportsRule(c.rule))
+        error = std::string(sideName(type)) + " cannot run " + c.rule.toString();
+    else if (c.wrap && !engine->canWrap())
+        error = std::string(sideName(type)) + " cannot wrap";
+    
+    if (!error.empty())
+    {
+        delete engine;
+        return nullptr;
+    }
+    
+    engine->setRule(c.rule);
+    engine->setWrap(c.wrap);
+    engine->setStates(0, 0, c.cols, c.rows, c.states.data());
+    
+    return engine;
+}
+
+void GOLVerifier::createBoard(const Case& c, bool unbounded)
+{
+    Board& b = m_board;
+    
+    b.rule = c.rule;
+    b.wrap = c.wrap;
+    b.margin = unbounded ? c.generations * c.rule.radius + 1 : 0;
+    b.cols = c.cols + 2 * b.margin;
+    b.rows = c.rows + 2 * b.margin;
+    
+    b.cells.assign((size_t)b.cols * b.rows, 0);
+    b.next.assign(b.cells.size(), 0);
+    b.live = GOLBounds();
+    b.stale = GOLBounds();
+    b.population = 0;
+    
+    for (int y = 0; y < c.rows; ++y)
+    {
+        for (int x = 0; x < c.cols; ++x)
+        {
+            uint8_t state = c.states[(size_t)y * c.cols + x];
+            
+            if (state)
+            {
+                b.cells[(size_t)(y + b.margin) * b.cols + x + b.margin] = state;
+                b.live.extend(x + b.margin, y + b.margin);
+                b.population += state == 1;
+            }
+        }
+    }
+}
+
+// the rule cell by cell, over the living cells and as far as they reach
+void GOLVerifier::stepBoard()
+{
+    Board& b = m_board;
+    const int r = b.rule.radius;
+    
+    GOLBounds region(0, 0, b.cols - 1, b.rows - 1);
+    
+    if (!b.wrap)
+    {
+        region = GOLBounds(b.live.x0 - r, b.live.y0 - r, b.live.x1 + r, b.live.y1 + r).intersected(region);
+        
+        // next still holds the generation before, whatever of it is left
+        // outside would come back with the swap
+        region.extend(b.stale);
+    }
+    
+    GOLBounds live;
+    b.population = 0;
+    
+    for (int y = region.y0; y <= region.y1; ++y)
+    {
+        for (int x = region.x0; x <= region.x1; ++x)
+        {
+            const size_t i = (size_t)y * b.cols + x;
+            const uint8_t state = b.cells[i];
+            uint8_t next;
+            
+            if (state == 0)
+                next = b.rule.next(false, neighbours(x, y)) ? 1 : 0;
+            else if (state == 1)
+                next = b.rule.next(true, neighbours(x, y)) ? 1 : (b.rule.states > 2 ? 2 : 0);
+            else
+                next = state + 1 < b.rule.states ? state + 1 : 0;
+            
+            b.next[i] = next;
+            if (next)
+                live.extend(x, y);
+            b.population += next == 1;
+        }
+    }
+    
+    b.cells.swap(b.next);
+    b.stale = b.live;
+    b.live = live;
+}
+
+int GOLVerifier::neighbours(int x, int y) const
+{
+    const Board& b = m_board;
+    const int r = b.rule.radius;
+    
+    int n = 0;
+    
+    for (int dy = -r; dy <= r; ++dy)
+    {
+        for (int dx = -r; dx <= r; ++dx)
+        {
+            if ((dx == 0 && dy == 0) || (b.rule.vonNeumann && std::abs(dx) + std::abs(dy) > r)) { continue; }
+            
+            int nx = x + dx, ny = y + dy;
+            
+            if (b.wrap)
+            {
+                nx = (nx % b.cols + b.cols) % b.cols;
+                ny = (ny % b.rows + b.rows) % b.rows;
+            }
+            else if (nx < 0 || ny < 0 || nx >= b.cols || ny >= b.rows)
+                continue;
+            
+            n += b.cells[(size_t)ny * b.cols + nx] == 1;
+        }
+    }
+    
+    return n;
+}
+
+
+void GOLVerifier::read(GOLEngine* engine, std::vector<uint8_t>& states) const
+{
+    const Board& b = m_board;
+    
+    if (engine)
+    {
+        states.resize((size_t)engine->columns() * engine->rows());
+        engine->getStates(0, 0, engine->columns(), engine->rows(), states.data());
+        return;
+    }
+    
+    const int cols = b.cols - 2 * b.margin, rows = b.rows - 2 * b.margin;
+    states.resize((size_t)cols * rows);
+    
+    for (int y = 0; y < rows; ++y)
+        std::memcpy(&states[(size_t)y * cols], &b.cells[(size_t)(y + b.margin) * b.cols + b.margin], cols);
+}
+
+std::string GOLVerifier::checkStats(GOLEngine* engine, const std::vector<uint8_t>& states, uint64_t population,
+                                    bool step) const
+{
+    const int cols = engine->columns();
+    
+    GOLBounds bounds;
+    uint64_t alive = 0;
+    for (size_t i = 0; i < states.size(); ++i)
+    {
+        if (states[i])
+            bounds.extend((int)(i % cols), (int)(i / cols));
+        alive += states[i] == 1;
+    }
+    
+    if (engine->population() != population)
+        return "population " + std::to_string(engine->population()) + " instead of " + std::to_string(population);
+    
+    if (engine->boardPopulation() != alive)
+        return "board population " + std::to_string(engine->boardPopulation()) + " instead of " + std::to_string(alive);
+    
+    // exact after a step, the edits before may have left it too large
+    const GOLBounds kept = engine->bounds();
+    
+    if (step ? !sameBounds(kept, bounds) : !sameBounds(kept.intersected(bounds), bounds))
+        return "bounds " + boundsString(kept) + ", the board has " + boundsString(bounds);
+    
+    return std::string();
+}
+
+// every cell that differs from the generation before lies in the boxes the
+// engine reports as changed, if it keeps track of them
+std::string GOLVerifier::checkChanges(GOLEngine* engine, const std::vector<uint8_t>& before,
+                                      const std::vector<uint8_t>& states) const
+{
+    std::vector<GOLBounds> boxes;
+    if (!engine->changedRegions(boxes)) { return std::string(); }
+    
+    const int cols = engine->columns();
+    
+    for (size_t i = 0; i < states.size(); ++i)
+    {
+        if (states[i] == before[i]) { continue; }
+        
+        const int x = (int)(i % cols), y = (int)(i / cols);
+        bool inside = false;
+        
+        for (const GOLBounds& box : boxes)
+            inside |= x >= box.x0 && x <= box.x1 && y >= box.y0 && y <= box.y1;
+        
+        if (!inside)
+            return "cell " + std::to_string(x) + ", " + std::to_string(y) + " changed outside the changed regions";
+    }
+    
+    return std::string();
+}
+
+
+void GOLVerifier::report(const Case& c, int a, int b, int exponent, const Result& result)
+{
+    QString name = QString::fromStdString(c.name);
+    if (exponent > 0)
+        name += QString(" 2^%1").arg(exponent);
+    
+    QString line = QString("%1 %2 %3  ").arg(name, -20).arg(sideName(a), -12).arg(sideName(b), -12);
+    
+    switch (result.outcome)
+    {
+    case Result::Match:
+        ++m_matched;
+        line += QString("ok, %1 generations, checksum %2").arg(result.generation)
+                .arg((qulonglong)result.checksums[0], 16, 16, QChar('0'));
+        break;
+        
+    case Result::Diverged:
+        ++m_diverged;
+        line += QString("DIVERGED in generation %1, ").arg(result.generation);
+        
+        if (result.message.empty())
+            line += QString("%1 cells in %2, checksums %3 and %4").arg(result.cells)
+                    .arg(QString::fromStdString(boundsString(result.region)))
+                    .arg((qulonglong)result.checksums[0], 16, 16, QChar('0'))
+                    .arg((qulonglong)result.checksums[1], 16, 16, QChar('0'));
+        else
+            line += QString::fromStdString(result.message);
+        break;
+        
+    case Result::Skipped:
+        ++m_skipped;
+        line += QString("skipped, %1").arg(QString::fromStdString(result.message));
+        break;
+    }
+    
+    QTextStream(stdout) << line << "\n";
+}
+
+void GOLVerifier::reportSettling(const Settling& s, int type, bool runner, const Result& result)
+{
+    QString line = QString("%1 %2 %3  ").arg(QString(s.pattern.name), -20)
+                   .arg(sideName(type), -12).arg(runner ? QString("runner") : QString("2^%1").arg(s.exponent), -12);
+    
+    switch (result.outcome)
+    {
+    case Result::Match:
+        ++m_matched;
+        line += QString("ok, %1 after %2 generations").arg(QString::fromStdString(result.message))
+                .arg(result.generation);
+        break;
+        
+    case Result::Diverged:
+        ++m_diverged;
+        line += QString("WRONG after %1 generations, %2 instead of %3").arg(result.generation)
+                .arg(QString::fromStdString(result.message))
+                .arg(QString::fromStdString(settledString(s.state, s.period)));
+        break;
+        
+    case Result::Skipped:
+        ++m_skipped;
+        line += QString("skipped, %1").arg(QString::fromStdString(result.message));
+        break;
+    }
+    
+    QTextStream(stdout) << line << "\n";
+}
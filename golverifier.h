@@ -0,0 +1,174 @@
+#ifndef GOLVERIFIER_H
+#define GOLVERIFIER_H
+
+
+#define VERIFY_GENERATIONS  500  // for pattern files given on the command line
+#define VERIFY_FILE_MARGIN  32   // dead cells around such a pattern
+#define VERIFY_SOUP_DENSITY 35   // percent living cells of the soups
+#define VERIFY_SEED         20190501
+
+
+#include "golengine.h"
+#include "golperiod.h"
+
+#include <QString>
+#include <QStringList>
+
+#include <string>
+#include <vector>
+
+
+// Runs two engines in lockstep on the same board and compares them every
+// generation, cell by cell through a checksum of the board and by the
+// population, bounds and changed regions they keep themselves. Reports the
+// first generation that differs and the box of the cells that do.
+//
+// Built as its own target (GameOfLifeVerify.pro), run with --help for the
+// options.
+//
+// Engines that leap (HashLife) are compared a second time in steps of
+// 2^k generations, against as many single generations of the other side.
+//
+// Either side may be the reference: the cell by cell loop GOLScene::tick()
+// used to be, run on a board of its own. It takes on the edges of the engine
+// it is compared with, dead or wrapped around for the bounded engines and
+// none at all for the unbounded ones (!canWrap()), for which the board is
+// only the window that is compared. Their population counts the cells
+// beyond it as well, it is checked against the whole plane of the other side
+// and the population of the board against the window.
+//
+// The corpus covers spaceships, a gun, methuselahs, oscillators, soups of
+// every rule family and patterns right at the edges, the wrap seam and the
+// tile borders of the engines.
+//
+// A second corpus runs every engine alone with GOLPeriodDetector the way
+// GOLScene::tick() does at a step exponent, and through GOLRunner with
+// --stop-when-settled, and checks the state and period it settles at.
+
+class GOLVerifier
+{
+public:
+    
+    // an engine type or the reference
+    static const int Reference = GOLEngine::TypeCount;
+    
+    // rle (without the rule) at x, y on the board, a soup over all of it if NULL
+    struct Pattern
+    {
+        const char* name;
+        const char* rle;
+        const char* rule;
+        int cols, rows, x, y;
+        int generations;
+        bool wrap;
+    };
+    
+    // a pattern stepped in leaps of 2^exponent generations, with the state
+    // and period the detector has to find within pattern.generations
+    struct Settling
+    {
+        Pattern pattern;
+        int exponent;
+        GOLPeriodDetector::State state;
+        uint64_t period;
+    };
+    
+    // a board to verify, the states row-major
+    struct Case
+    {
+        std::string name;
+        GOLRule rule;
+        int cols, rows, generations;
+        bool wrap;
+        std::vector<uint8_t> states;
+    };
+    
+    struct Result
+    {
+        enum Outcome { Match, Diverged, Skipped } outcome;
+        
+        int generation;        // the first that differs, or the last one run
+        uint64_t checksums[2]; // of the boards of both sides in that generation
+        uint64_t cells;        // that differ
+        GOLBounds region;      // box of these
+        std::string message;   // why skipped, or what else differs
+    };
+    
+    
+    GOLVerifier();
+    
+    
+    // returns the exit code of the process
+    int run(const QStringList& arguments);
+    
+    // the states of both sides compared from generation 0 to c.generations,
+    // every 2^exponent generations: a side that can leap that far takes one
+    // step of 2^exponent, the other one as many single generations
+    Result verify(const Case& c, int a, int b, int exponent = 0);
+    
+    // the state and period the detector finds with an engine, in the message;
+    // with runner from the statistics of a headless run of the pattern, which
+    // leaps as far as it can instead of by s.exponent
+    Result settle(const Settling& s, int type, bool runner);
+    
+    static const std::vector<Pattern>& corpus();
+    static const std::vector<Settling>& settlingCorpus();
+    static Case soup(const std::string& name, const GOLRule& rule, int cols, int rows,
+                     int generations, bool wrap);
+    
+    static const char* sideName(int side);
+    static int maxStepExponent(int side);
+    static uint64_t checksum(const std::vector<uint8_t>& states);
+    
+    
+private:
+    
+    // the reference, the board with a margin around it that is larger than
+    // anything can travel in the generations of the case if unbounded
+    struct Board
+    {
+        GOLRule rule;
+        int cols, rows, margin;
+        bool wrap;
+        std::vector<uint8_t> cells, next;
+        GOLBounds live, stale; // of the cells not dead, in cells and next
+        uint64_t population;   // of all of cells, margin included
+    };
+    
+    
+    // Methods:
+    
+    bool parse(const QStringList& arguments);
+    bool decode(const Pattern& pattern, Case& c);
+    bool load(const QString& path, Case& c);
+    
+    GOLEngine* createEngine(int type, const Case& c, std::string& error) const;
+    void createBoard(const Case& c, bool unbounded);
+    void stepBoard();
+    int neighbours(int x, int y) const;
+    
+    // the board of one side, GOLEngine::getStates() or the reference
+    void read(GOLEngine* engine, std::vector<uint8_t>& states) const;
+    std::string checkStats(GOLEngine* engine, const std::vector<uint8_t>& states, uint64_t population,
+                           bool step) const;
+    std::string checkChanges(GOLEngine* engine, const std::vector<uint8_t>& before,
+                             const std::vector<uint8_t>& states) const;
+    
+    void report(const Case& c, int a, int b, int exponent, const Result& result);
+    void reportSettling(const Settling& s, int type, bool runner, const Result& result);
+    
+    
+    // Attributes:
+    
+    std::vector<std::pair<int, int>> m_pairs;
+    QStringList m_patterns, m_files;
+    int m_generations;
+    bool m_list;
+    
+    Board m_board;
+    
+    int m_matched, m_diverged, m_skipped;
+    
+};
+
+#endif // GOLVERIFIER_H
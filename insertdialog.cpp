@@ -1,5 +1,6 @@
 #include "insertdialog.h"
 #include "golscene.h"
+#include "golfile.h"
 
 
 InsertDialog::InsertDialog(const QString& filepath, GOLScene* scene, QWidget* parent)
@@ -27,8 +28,8 @@ void InsertDialog::insertPressed()
     int rotation = ui.RotationSpin->value();
     
     int cols, rows;
-    bool* cells = GOLScene::loadFile(m_filepath, cols, rows);
-    cells = GOLScene::rotateCells(cells, cols, rows, rotation);
+    bool* cells = GOLFile::load(m_filepath, cols, rows);
+    cells = GOLFile::rotate(cells, cols, rows, rotation);
     
     m_scene->insert(cells, x, y, cols, rows);
     
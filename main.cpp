@@ -1,8 +1,20 @@
 #include "mainwindow.h"
+#include "golrunner.h"
+
 #include <QApplication>
+#include <QCoreApplication>
 
 int main(int argc, char *argv[])
 {
+    // batch runs must not need a display
+    if (GOLRunner::requested(argc, argv))
+    {
+        QCoreApplication a(argc, argv);
+        GOLRunner runner;
+        
+        return runner.run(a.arguments());
+    }
+    
     QApplication a(argc, argv);
     MainWindow w;
     w.show();
@@ -1,6 +1,9 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "golscene.h"
+#include "golperiod.h"
+#include "golthreadpool.h"
+#include "goltrace.h"
 #include "renderdialog.h"
 #include "insertdialog.h"
 
@@ -8,18 +11,19 @@
 #include <QApplication>
 #include <QFileDialog>
 #include <QFileInfo>
+#include <QMessageBox>
 #include <QStandardPaths>
 #include <QThread>
+#include <QTimer>
 #include <QWheelEvent>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonValue>
 #include <QTextStream>
 
-#include <omp.h>
-
 
 #define WINDOW_TITLE "Game Of Life Demo"
+#define PROFILE_INTERVAL 500 // ms between two updates of the timings
 
 
 MainWindow::MainWindow(QWidget *parent)
@@ -30,6 +34,8 @@ MainWindow::MainWindow(QWidget *parent)
     ui.setupUi(this);
     setWindowTitle(WINDOW_TITLE);
     
+    GOLTrace::setThreadName("GUI");
+    
     ui.ColumnsSpin->setValue(GRID_WIDTH);
     ui.RowsSpin->setValue(GRID_HEIGHT);
     ui.fpsSpinbox->setValue(START_FPS);
@@ -45,8 +51,11 @@ MainWindow::MainWindow(QWidget *parent)
     ui.graphicsView->setMouseTracking(true);
     ui.graphicsView->setScene(m_scene);
     
-    connect(m_scene, SIGNAL(aliveCellsSignal(int)), this, SLOT(aliveCells(int)));
-    connect(m_scene, SIGNAL(tickCountSignal(int)), this, SLOT(tickCount(int)));
+    connect(m_scene, SIGNAL(statsSignal()), this, SLOT(stats()));
+    connect(m_scene, SIGNAL(rateSignal(double)), this, SLOT(rate(double)));
+    connect(m_scene, SIGNAL(advanceSignal(qint64,qint64)), this, SLOT(advanceProgress(qint64,qint64)));
+    connect(m_scene, SIGNAL(advanceDoneSignal(qint64)), this, SLOT(advanceDone(qint64)));
+    connect(m_scene, SIGNAL(settledSignal(int,qint64)), this, SLOT(settled(int,qint64)));
     connect(m_scene, SIGNAL(pauseSignal(bool)), this, SLOT(setPaused(bool)));
     connect(m_scene, SIGNAL(colsSignal(int)), this, SLOT(sceneSetCols(int)));
     connect(m_scene, SIGNAL(rowsSignal(int)), this, SLOT(sceneSetRows(int)));
@@ -54,23 +63,60 @@ MainWindow::MainWindow(QWidget *parent)
     
     connect(ui.PauseButton, SIGNAL(pressed()), this, SLOT(pausePressed()));
     connect(ui.NextTickButton, SIGNAL(pressed()), this, SLOT(nextTickPressed()));
+    connect(ui.AdvanceButton, SIGNAL(pressed()), this, SLOT(advancePressed()));
     connect(ui.RenderButton, SIGNAL(pressed()), this, SLOT(renderPressed()));
     connect(ui.ResetButton, SIGNAL(pressed()), this, SLOT(resetPressed()));
     connect(ui.LoadButton, SIGNAL(pressed()), this, SLOT(loadPressed()));
     connect(ui.SaveButton, SIGNAL(pressed()), this, SLOT(savePressed()));
     connect(ui.ChaosButton, SIGNAL(pressed()), this, SLOT(chaosPressed()));
     connect(ui.InsertButton, SIGNAL(pressed()), this, SLOT(insertPressed()));
+    connect(ui.ProfileCsvButton, SIGNAL(pressed()), this, SLOT(profileCsvPressed()));
     
     connect(ui.fpsSpinbox, SIGNAL(valueChanged(int)), m_scene, SLOT(fpsChanged(int)));
+    connect(ui.UncappedCheck, SIGNAL(toggled(bool)), this, SLOT(uncappedChanged(bool)));
+    connect(ui.StopCheck, SIGNAL(toggled(bool)), m_scene, SLOT(stopWhenSettledChanged(bool)));
+    connect(ui.ProfileCheck, SIGNAL(toggled(bool)), this, SLOT(profileChanged(bool)));
+    connect(ui.TraceCheck, SIGNAL(toggled(bool)), this, SLOT(traceChanged(bool)));
     connect(ui.CellSizeSpin, SIGNAL(valueChanged(int)), this, SLOT(cellSizeChanged(int)));
     connect(ui.ColumnsSpin, SIGNAL(valueChanged(int)), this, SLOT(colsChanged(int)));
     connect(ui.RowsSpin, SIGNAL(valueChanged(int)), this, SLOT(rowsChanged(int)));
     
+    for (int i = 0; i < GOLEngine::TypeCount; ++i)
+        ui.EngineCombo->addItem(GOLEngine::typeName((GOLEngine::Type)i));
+    ui.EngineCombo->setCurrentIndex(m_scene->engineType());
+    
+    connect(ui.EngineCombo, SIGNAL(currentIndexChanged(int)), this, SLOT(engineChanged(int)));
+    // queued, the scene switches engines with its cells locked
+    connect(m_scene, SIGNAL(engineSignal(int)), ui.EngineCombo, SLOT(setCurrentIndex(int)),
+            Qt::QueuedConnection);
+    connect(ui.StepSpin, SIGNAL(valueChanged(int)), this, SLOT(stepExponentChanged(int)));
+    connect(ui.WrapCheck, SIGNAL(toggled(bool)), this, SLOT(wrapChanged(bool)));
+    connect(ui.RuleEdit, SIGNAL(editingFinished()), this, SLOT(ruleEdited()));
+    connect(m_scene, SIGNAL(ruleSignal(QString)), this, SLOT(ruleChanged(QString)));
+    
+    // as GOL_THREADS and GOL_PLACEMENT set up the pool
+    for (int i = 0; i < GOLThreadPool::PlacementCount; ++i)
+        ui.PlacementCombo->addItem(GOLThreadPool::placementName((GOLThreadPool::Placement)i));
+    ui.PlacementCombo->setCurrentIndex(GOLThreadPool::instance().placement());
+    ui.ThreadsSpin->setValue(GOLThreadPool::instance().threadCount());
+    
+    connect(ui.ThreadsSpin, SIGNAL(editingFinished()), this, SLOT(threadsChanged()));
+    connect(ui.PlacementCombo, SIGNAL(currentIndexChanged(int)), this, SLOT(threadsChanged()));
+    
     
     addShortcuts();
     
     
-    aliveCells(0);
+    m_profileTimer = new QTimer(this);
+    m_profileTimer->setInterval(PROFILE_INTERVAL);
+    connect(m_profileTimer, SIGNAL(timeout()), this, SLOT(profileRefresh()));
+    
+    
+    stats();
+    ui.AdvanceProgress->hide();
+    ui.ProfileLabel->hide();
+    ui.ProfileCsvButton->hide();
+    ui.ZoomLabel->hide();
     
     if (m_scene->paused())
         setWindowTitle(QString(WINDOW_TITLE) + " (Paused)");
@@ -82,14 +128,39 @@ MainWindow::~MainWindow()
 }
 
 
-void MainWindow::aliveCells(int count)
+void MainWindow::stats()
 {
-    ui.AliveCellsLabel->setText(QString("Living Cells: %1").arg(count));
+    const GOLStats& stats = m_scene->stats();
+    
+    ui.EvolutionsLabel->setText(QString("Evolutions: %1").arg(stats.generation));
+    ui.AliveCellsLabel->setText(QString("Living Cells: %1").arg(stats.population));
+    
+    QString tip;
+    
+    if (!stats.bounds.empty())
+        tip = QString("Bounding box: %1 x %2 at %3, %4")
+              .arg(stats.bounds.width()).arg(stats.bounds.height())
+              .arg(stats.bounds.x0).arg(stats.bounds.y0);
+    
+    // HashLife and the infinite engine keep evolving what left the board
+    if (stats.universe != stats.population)
+        tip += QString(tip.isEmpty() ? "" : "\n") + QString("Off the board: %1").arg(stats.universe - stats.population);
+    
+    ui.AliveCellsLabel->setToolTip(tip);
+    
+    if (stats.tileCount == 0)
+        ui.ActiveTilesLabel->setText(QString());
+    else
+        ui.ActiveTilesLabel->setText(QString("Active Tiles: %1/%2").arg(stats.activeTiles).arg(stats.tileCount));
 }
 
-void MainWindow::tickCount(int count)
+void MainWindow::rate(double generationsPerSecond)
 {
-    ui.EvolutionsLabel->setText(QString("Evolutions: %1").arg(count));
+    if (generationsPerSecond <= 0.0)
+        ui.RateLabel->setText(QString());
+    else
+        ui.RateLabel->setText(QString("Gen/s: %1").arg(generationsPerSecond, 0, 'f', 
+                                                        generationsPerSecond < 100.0 ? 1 : 0));
 }
 
 
@@ -119,6 +190,44 @@ void MainWindow::nextTickPressed()
     m_scene->tick();
 }
 
+void MainWindow::advancePressed()
+{
+    if (ui.AdvanceProgress->isVisible())
+    {
+        m_scene->cancelAdvance();
+        return;
+    }
+    
+    ui.AdvanceButton->setText("Cancel");
+    ui.AdvanceProgress->setValue(0);
+    ui.AdvanceProgress->show();
+    
+    m_scene->advance((quint64)ui.AdvanceSpin->value());
+}
+
+void MainWindow::advanceProgress(qint64 done, qint64 total)
+{
+    ui.AdvanceProgress->setValue((int)(done * 1000 / std::max(total, (qint64)1)));
+}
+
+void MainWindow::settled(int state, qint64 period)
+{
+    if (state == GOLPeriodDetector::Oscillating)
+        ui.SettledLabel->setText(QString("Period %1").arg(period));
+    else if (state != GOLPeriodDetector::Running)
+        ui.SettledLabel->setText(GOLPeriodDetector::stateName((GOLPeriodDetector::State)state));
+    else
+        ui.SettledLabel->setText(QString());
+}
+
+void MainWindow::advanceDone(qint64 done)
+{
+    Q_UNUSED(done);
+    
+    ui.AdvanceButton->setText("Advance");
+    ui.AdvanceProgress->hide();
+}
+
 void MainWindow::resetPressed()
 {
     m_scene->reset();
@@ -191,6 +300,86 @@ void MainWindow::savePressed()
     }
 }
 
+void MainWindow::profileChanged(bool profile)
+{
+    m_scene->profiler().clear();
+    m_scene->profiler().setEnabled(profile);
+    
+    ui.ProfileLabel->setText(QString());
+    ui.ProfileLabel->setVisible(profile);
+    ui.ProfileCsvButton->setVisible(profile);
+    
+    if (profile)
+        m_profileTimer->start();
+    else
+        m_profileTimer->stop();
+}
+
+void MainWindow::profileRefresh()
+{
+    const GOLProfiler& profiler = m_scene->profiler();
+    
+    GOLProfiler::Summary step = profiler.summary(GOLProfiler::Step);
+    GOLProfiler::Summary lock = profiler.summary(GOLProfiler::LockWait);
+    GOLProfiler::Summary render = profiler.summary(GOLProfiler::Render);
+    GOLProfiler::Summary paint = profiler.summary(GOLProfiler::Paint);
+    GOLProfiler::Summary queue = profiler.summary(GOLProfiler::SignalLatency);
+    GOLProfiler::Summary tick = profiler.summary(GOLProfiler::TickInterval);
+    
+    auto ms = [](const GOLProfiler::Summary& s) 
+        { return QString("%1/%2").arg(s.p50, 0, 'f', 2).arg(s.p99, 0, 'f', 2); };
+    
+    QString fps = tick.count > 0 && tick.p50 > 0.0 ? QString::number(1000.0 / tick.p50, 'f', 1) : QString("-");
+    QString target = m_scene->uncapped() ? QString("max") : QString::number(m_scene->fps());
+    
+    ui.ProfileLabel->setText(QString("Step %1  Lock %2  Render %3  Paint %4  Queue %5  FPS %6/%7")
+                             .arg(ms(step)).arg(ms(lock)).arg(ms(render)).arg(ms(paint)).arg(ms(queue))
+                             .arg(fps).arg(target));
+}
+
+void MainWindow::profileCsvPressed()
+{
+    QString fileName = QFileDialog::getSaveFileName(this, "Save Timings", 
+                           m_lastDir + "/timings.csv", "CSV (*.csv)");
+    
+    if (fileName.isEmpty()) { return; }
+    
+    QFile file(fileName);
+    if (!file.open(QFile::WriteOnly | QFile::Text))
+    {
+        QMessageBox::warning(this, "Save Timings", QString("Could not write %1.").arg(fileName));
+        return;
+    }
+    
+    QTextStream out(&file);
+    out << "metric,samples,mean_ms,p50_ms,p90_ms,p99_ms,max_ms\n";
+    
+    for (int m = 0; m < GOLProfiler::MetricCount; ++m)
+    {
+        GOLProfiler::Summary s = m_scene->profiler().summary((GOLProfiler::Metric)m);
+        
+        out << GOLProfiler::metricName((GOLProfiler::Metric)m) << "," << s.count << ","
+            << s.mean << "," << s.p50 << "," << s.p90 << "," << s.p99 << "," << s.max << "\n";
+    }
+}
+
+void MainWindow::traceChanged(bool trace)
+{
+    if (trace)
+    {
+        GOLTrace::start();
+        return;
+    }
+    
+    GOLTrace::stop();
+    
+    QString fileName = QFileDialog::getSaveFileName(this, "Save Trace", 
+                           m_lastDir + "/trace.json", "Chrome Trace (*.json)");
+    
+    if (!fileName.isEmpty() && !GOLTrace::save(fileName.toLocal8Bit().constData()))
+        QMessageBox::warning(this, "Save Trace", QString("Could not write %1.").arg(fileName));
+}
+
 void MainWindow::reloadFilePressed()
 {
     QFile file(m_lastDir+"/"+m_lastFile);
@@ -205,21 +394,45 @@ void MainWindow::cellSizeChanged(int size)
 {
     size = std::max(size, 1);
     m_scene->setCellSize(size);
+    m_scene->setZoomOut(0);
     m_scene->update();
     
     bool prev = ui.CellSizeSpin->blockSignals(true);
     ui.CellSizeSpin->setValue(size);
     ui.CellSizeSpin->blockSignals(prev);
+    
+    ui.ZoomLabel->hide();
 }
 
 void MainWindow::cellSizeInc()
 {
-    cellSizeChanged(m_scene->cellSize()+1);
+    if (m_scene->zoomOut() > 0)
+        zoomOutChanged(m_scene->zoomOut()-1);
+    else
+        cellSizeChanged(m_scene->cellSize()+1);
 }
 
 void MainWindow::cellSizeDec()
 {
-    cellSizeChanged(m_scene->cellSize()-1);
+    if (m_scene->cellSize() > 1)
+        cellSizeChanged(m_scene->cellSize()-1);
+    else
+        zoomOutChanged(m_scene->zoomOut()+1);
+}
+
+void MainWindow::zoomOutChanged(int level)
+{
+    if (level <= 0)
+    {
+        cellSizeChanged(1);
+        return;
+    }
+    
+    m_scene->setCellSize(1);
+    m_scene->setZoomOut(level);
+    
+    ui.ZoomLabel->setText(QString("1:%1").arg(1 << m_scene->zoomOut()));
+    ui.ZoomLabel->show();
 }
 
 void MainWindow::wheelEvent(QWheelEvent* event)
@@ -237,6 +450,57 @@ void MainWindow::wheelEvent(QWheelEvent* event)
     QMainWindow::wheelEvent(event);
 }
 
+void MainWindow::engineChanged(int index)
+{
+    m_scene->setEngineType((GOLEngine::Type)index);
+    
+    ui.StepSpin->setMaximum(m_scene->engine()->maxStepExponent());
+    m_scene->setStepExponent(ui.StepSpin->value());
+    
+    ui.WrapCheck->setEnabled(m_scene->engine()->canWrap());
+    m_scene->setWrap(ui.WrapCheck->isChecked());
+}
+
+void MainWindow::stepExponentChanged(int exponent)
+{
+    m_scene->setStepExponent(exponent);
+}
+
+void MainWindow::wrapChanged(bool wrap)
+{
+    m_scene->setWrap(wrap);
+}
+
+void MainWindow::threadsChanged()
+{
+    m_scene->setThreads(ui.ThreadsSpin->value(), (GOLThreadPool::Placement)ui.PlacementCombo->currentIndex());
+}
+
+void MainWindow::ruleEdited()
+{
+    GOLRule rule;
+    
+    if (GOLRule::parse(ui.RuleEdit->text().toStdString(), rule))
+        m_scene->setRule(rule);
+    else
+        QMessageBox::warning(this, "Invalid Rule", "\"" + ui.RuleEdit->text() + "\" is not a rule like "
+                             "B3/S23, B2/S/C3 (Generations) or R5,C0,M1,S34..58,B34..45,NM "
+                             "(Larger than Life), rules with birth on 0 neighbours are not supported.");
+    
+    ruleChanged(QString::fromStdString(m_scene->rule().toString()));
+}
+
+void MainWindow::ruleChanged(const QString& rule)
+{
+    ui.RuleEdit->setText(rule);
+}
+
+void MainWindow::uncappedChanged(bool uncapped)
+{
+    ui.fpsSpinbox->setEnabled(!uncapped);
+    m_scene->uncappedChanged(uncapped);
+}
+
 void MainWindow::rowsChanged(int rows)
 {
     m_scene->setRows(rows);
@@ -6,6 +6,7 @@
 #include <QMainWindow>
 
 class GOLScene;
+class QTimer;
 class QWheelEvent;
 
 class MainWindow : public QMainWindow
@@ -18,8 +19,8 @@ public:
     
 public slots:
     
-    void aliveCells(int count);
-    void tickCount(int count);
+    void stats();
+    void rate(double generationsPerSecond);
     
     void cursorCoordsChanged(int col, int row);
     
@@ -27,8 +28,20 @@ public slots:
     void colsChanged(int cols);
     
     void cellSizeChanged(int size);
-    void cellSizeInc();
-    void cellSizeDec();
+    void cellSizeInc(); // zooms in again when zoomed out
+    void cellSizeDec(); // zooms out below a cell size of 1
+    void zoomOutChanged(int level);
+    
+    void engineChanged(int index);
+    void stepExponentChanged(int exponent);
+    void wrapChanged(bool wrap);
+    void threadsChanged();
+    void ruleEdited();
+    void ruleChanged(const QString& rule);
+    void uncappedChanged(bool uncapped);
+    void advanceProgress(qint64 done, qint64 total);
+    void advanceDone(qint64 done);
+    void settled(int state, qint64 period);
     
 private slots:
     
@@ -38,6 +51,7 @@ private slots:
     void pausePressed();
     void setPaused(bool paused);
     void nextTickPressed();
+    void advancePressed();
     void savePressed();
     void loadPressed();
     void insertPressed();
@@ -47,6 +61,11 @@ private slots:
     
     void reloadFilePressed();
     
+    void profileChanged(bool profile);
+    void profileRefresh();
+    void profileCsvPressed();
+    void traceChanged(bool trace);
+    
     
 protected:
     
@@ -65,6 +84,8 @@ private:
     
     GOLScene* m_scene;
     
+    QTimer* m_profileTimer;
+    
     QString m_lastDir, m_lastFile;
     
     
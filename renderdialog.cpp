@@ -1,5 +1,8 @@
 #include "renderdialog.h"
+#include "golengine.h"
+#include "golfile.h"
 #include "golscene.h"
+#include "goltrace.h"
 
 #include <QColorDialog>
 #include <QMessageBox>
@@ -7,8 +10,6 @@
 #include <QFile>
 #include <QTextStream>
 #include <QThread>
-#include <QSvgGenerator>
-#include <QPainter>
 #include <QFileDialog>
 
 
@@ -31,7 +32,7 @@ RenderDialog::RenderDialog(GOLScene* scene, const QString& lastDir,
     setWindowFlags(windowFlags() & ~Qt::WindowContextHelpButtonHint);
     
     {
-        std::lock_guard<std::mutex> guard(m_scene->_cellsMutex());
+        std::lock_guard<GOLTicketMutex> guard(m_scene->_cellsMutex());
         
         ui.CellSizeSpin->setValue(m_scene->cellSize());
         ui.XSpin->setMinimum(0);
@@ -128,14 +129,46 @@ void RenderDialog::renderPressed()
     
     this->setEnabled(false);
     
-    GOLScene* renderScene = new GOLScene(this);
-    renderScene->pauseChanged(true);
-    renderScene->setCells(m_scene->copyCells(), m_scene->columns(), m_scene->rows());
+    // a copy of the engine with everything that decides how it evolves: the
+    // type, rule, edges, step exponent and the states of the board
+    GOLEngine* engine;
+    
+    {
+        std::lock_guard<GOLTicketMutex> guard(m_scene->_cellsMutex());
+        
+        const GOLEngine* source = m_scene->engine();
+        std::vector<uint8_t> states((size_t)source->columns() * source->rows());
+        source->getStates(0, 0, source->columns(), source->rows(), states.data());
+        
+        engine = GOLEngine::create(source->type(), source->columns(), source->rows());
+        engine->setRule(source->rule());
+        engine->setWrap(source->wraps());
+        engine->setStepExponent(source->stepExponent());
+        engine->setStates(0, 0, source->columns(), source->rows(), states.data());
+    }
+    
+    const int cols = engine->columns();
+    const int rows = engine->rows();
+    const int states = engine->rule().states;
+    
+    // dying states fade out towards the background like in the scene
+    std::vector<QColor> colors(states, bgColor);
+    for (int s = 1; s < states; ++s)
+    {
+        int alpha = s == 1 ? 255 : 40 + 160 * (states - s) / (states - 1);
+        colors[s] = QColor(bgColor.red() + (cellColor.red() - bgColor.red()) * alpha / 255,
+                           bgColor.green() + (cellColor.green() - bgColor.green()) * alpha / 255,
+                           bgColor.blue() + (cellColor.blue() - bgColor.blue()) * alpha / 255);
+    }
+    
+    std::vector<uint8_t> cells((size_t)cols * rows);
     
     //int numFrameDigits = std::to_string(frames).length();
     
     for (int i = 0; i < frames; ++i)
     {
+        GOLTraceScope scope("render frame", i);
+        
         QString filepath(directory + "/" + prefix + QString("%1").arg(i) + "." + format);
                    //QString("%1").arg(i, numFrameDigits, 10, QChar('0')) + ".html");
         
@@ -146,25 +179,19 @@ void RenderDialog::renderPressed()
             QThread::msleep(50);
         }
         
-        bool* cells = renderScene->copyCells();
+        engine->getStates(0, 0, cols, rows, cells.data());
         
         if (format == "html")
         {
-            success &= renderToHTML(filepath, cells, 
-                                    renderScene->columns(), renderScene->rows(),
-                                    x, y, width, height, cellSize,
-                                    cellColor, bgColor, showGrid);
+            success &= GOLFile::saveHTML(filepath, m_htmlTemplate, cells.data(), cols, rows,
+                                         x, y, width, height, cellSize, colors, showGrid);
         }
         else if (format == "svg")
         {
-            success &= renderToSVG(filepath, cells, 
-                                   renderScene->columns(), renderScene->rows(),
-                                   x, y, width, height, cellSize,
-                                   cellColor, bgColor, showGrid);
+            success &= GOLFile::saveSVG(filepath, cells.data(), cols, rows,
+                                        x, y, width, height, cellSize, colors, showGrid);
         }
         
-        delete[] cells;
-        
         if (!success)
         {
             QMessageBox::critical(this, "Rendering Error", 
@@ -173,10 +200,10 @@ void RenderDialog::renderPressed()
         }
         
         if (i < frames-1)
-            renderScene->tick();
+            engine->step();
     }
     
-    delete renderScene;
+    delete engine;
     
     this->setEnabled(true);
     
@@ -257,114 +284,6 @@ void RenderDialog::yChanged(int y)
 }
 
 
-bool RenderDialog::renderToHTML(const QString& filepath,
-                                const bool* cells, const int cols, const int rows, 
-                                const int x, const int y, const int width, const int height, 
-                                const int cellSize, const QColor& cellColor,
-                                const QColor& bgColor, const bool showGrid)
-{
-    QString html = m_htmlTemplate;
-    
-    if (showGrid)
-        html.replace("[borderstyle]", "border: 1px solid black;");
-    else
-        html.replace("[borderstyle]", "border: 0px solid transparent;");
-    
-    html.replace("[cellsize]", QString("%1px").arg(cellSize));
-    
-    html.replace("[cellcolor]", cellColor.name());
-    html.replace("[bgcolor]", bgColor.name());
-    
-    
-    QString cellTable;
-    
-    for (int r = y; r < std::min(y + height, rows); ++r)
-    {
-        cellTable += "\t<tr>\n";
-        
-        for (int c = x; c < std::min(x + width, cols); ++c)
-        {
-            if (cells[r * cols + c])
-                cellTable += "\t\t<td class=filled></td>\n";
-            else
-                cellTable += "\t\t<td></td>\n";
-        }
-        
-        cellTable += "\t</tr>\n";
-    }
-    
-    html.replace("[celltable]", cellTable);
-    
-    QFile file(filepath);
-    if (file.open(QIODevice::WriteOnly | QIODevice::Text))
-    {
-        QTextStream out(&file);
-        out << html;
-        file.close();
-    }
-    else
-        return false;
-    
-    return true;
-}
-
-bool RenderDialog::renderToSVG(const QString& filepath,
-                               const bool* cells, const int cols, const int rows, 
-                               const int x, const int y, const int width, const int height, 
-                               const int cellSize, const QColor& cellColor,
-                               const QColor& bgColor, const bool showGrid)
-{
-    QFile file(filepath);
-    if (file.open(QIODevice::WriteOnly))
-    {
-        QRect viewRect(0, 0, width * cellSize, height * cellSize);
-        
-        QSvgGenerator generator;
-        generator.setOutputDevice(&file);
-        generator.setSize(QSize(width * cellSize, height * cellSize));
-        generator.setViewBox(viewRect);
-        generator.setDescription("Generated by Pascal Sielski's Game Of Life Demo (2019)");
-        
-        QPainter painter;
-        painter.begin(&generator);
-        
-        painter.fillRect(viewRect, bgColor);
-        
-        for (int r = y; r < std::min(y + height, rows); ++r)
-        {
-            for (int c = x; c < std::min(x + width, cols); ++c)
-            {
-                if (cells[r * cols + c])
-                    painter.fillRect(QRect((c-x) * cellSize, (r-y) * cellSize,
-                                           cellSize, cellSize), cellColor);
-            }
-        }
-        
-        if (showGrid)
-        {
-            QPen pen(Qt::black, 1);
-            painter.setPen(pen);
-            
-            for (int i = 0; i < width; ++i)
-                painter.drawLine(i * cellSize, 0, i * cellSize, height * cellSize);
-            painter.drawLine(width * cellSize - 1, 0, width * cellSize - 1, height * cellSize);
-            
-            for (int i = 0; i < height; ++i)
-                painter.drawLine(0, i * cellSize, width * cellSize, i * cellSize);
-            painter.drawLine(0, height * cellSize, width * cellSize, height * cellSize);
-        }
-        
-        painter.end();
-    }
-    else
-    {
-        return false;
-    }
-    
-    return true;
-}
-
-
 void RenderDialog::loadHTMLTemplate(const QString& filepath)
 {
     QFile file(filepath);
@@ -7,6 +7,9 @@
 #include <QObject>
 #include <QDialog>
 
+#include <cstdint>
+#include <vector>
+
 
 class GOLScene;
 
@@ -50,18 +53,6 @@ private:
     
     // Methods:
     
-    bool renderToHTML(const QString& filepath,
-                      const bool* cells, const int cols, const int rows, 
-                      const int x, const int y, const int width, const int height, 
-                      const int cellSize, const QColor& cellColor,
-                      const QColor& bgColor, const bool showGrid);
-    
-    bool renderToSVG(const QString& filepath,
-                     const bool* cells, const int cols, const int rows,
-                     const int x, const int y, const int width, const int height,
-                     const int cellSize, const QColor& cellColor,
-                     const QColor& bgColor, const bool showGrid);
-    
     void showWarningDialog(const QString& warning);
     bool validFileName(const QString& str);
     
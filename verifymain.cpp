@@ -0,0 +1,11 @@
+#include "golverifier.h"
+
+#include <QCoreApplication>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    GOLVerifier verifier;
+    
+    return verifier.run(a.arguments());
+}